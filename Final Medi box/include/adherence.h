@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Dose adherence log.
+//
+// Every dose the alarm handles ends up as one fixed-size record: taken
+// (PB_Cancel), snoozed (PB_OK) or missed (never acknowledged). Records go
+// into a RAM ring that is flushed to NVS in bulk, and running counters
+// give the adherence rate without scanning the log.
+
+#define ADHERENCE_CAPACITY 128
+#define ADHERENCE_FLUSH_INTERVAL_MS (15UL * 60 * 1000)
+#define ADHERENCE_FLUSH_BATCH 16
+
+enum dose_action_t : uint8_t
+{
+  DOSE_TAKEN,
+  DOSE_SNOOZED,
+  DOSE_MISSED
+};
+
+struct adherence_record_t
+{
+  uint32_t due;       // local seconds, see schedule.h
+  uint8_t schedule_id;
+  uint8_t action;     // dose_action_t
+  uint16_t latency_s; // due time to acknowledgement, saturating
+};
+
+struct adherence_counters_t
+{
+  uint32_t taken;
+  uint32_t snoozed;
+  uint32_t missed;
+};
+
+void adherence_begin();
+void adherence_record(uint8_t schedule_id, int64_t due, dose_action_t action, int64_t latency_s);
+void adherence_flush(bool force);
+const adherence_counters_t &adherence_counters();
+float adherence_rate();
+void adherence_export(Print &out);
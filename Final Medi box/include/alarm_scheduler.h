@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include "build_features.h"
+#include "schedule.h"
+
+// Timer-driven alarm firing.
+//
+// The earliest next_due across all alarms is armed as an esp_timer
+// one-shot deadline computed from wall time. Expiry only sets a flag;
+// alarm_scheduler_next() is then polled by the main loop and by blocking
+// UI loops, so a dose is never skipped while a screen is up. Deadlines
+// missed while blocked are caught up: the latest elapsed dose of each
+// alarm rings late and any older ones are logged as missed.
+//
+// A snooze is a deadline of its own (snooze_due) on the same timer, so
+// nothing is polled between firings. Schedule, time zone and clock
+// changes are taken from the event bus (events.h) in
+// alarm_scheduler_pending().
+
+struct alarm_time_t
+{
+  bool alarm_state;
+  dose_schedule_t schedule;
+  int64_t next_due;
+  int64_t last_due;     // dose currently being rung or snoozed
+  int64_t snooze_due;   // re-ring time of last_due, SCHEDULE_NEVER if not snoozed
+  uint8_t snooze_count; // snoozes used on last_due
+  uint8_t tune;         // index into tunes, see melody.h
+};
+
+constexpr int n_alarm = feature_multi_alarm ? 2 : 1;
+extern alarm_time_t alarm_time[n_alarm];
+
+extern int snooze_minutes;
+extern int snooze_limit; // per dose
+
+// Firing latency of rung alarms relative to their due second
+struct alarm_latency_t
+{
+  uint32_t fired;
+  uint32_t late; // rung more than a second after due
+  int32_t last_ms;
+  int32_t max_ms;
+  int64_t total_ms;
+};
+
+void alarm_scheduler_begin();
+bool alarm_scheduler_pending();
+bool alarm_scheduler_next(int *alarm_idx, int64_t *due);
+void alarm_scheduler_rearm();
+bool alarm_scheduler_snooze(int alarm_idx);
+void alarm_scheduler_cancel_snooze(int alarm_idx);
+void alarm_scheduler_record_latency(int64_t due);
+int64_t alarm_scheduler_next_dose(int *which);
+const alarm_latency_t &alarm_latency();
+
+// Wall time in local microseconds, or -1 before the first clock sync
+int64_t local_time_us();
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+
+// Large clock and date glyphs.
+//
+// Digits, colon, space, dash and the letters of the month abbreviations are
+// upscaled from a 5x8 source font at compile time with edge-smoothing
+// (Scale2x/Scale3x), so the tables live in flash already in SSD1306 page
+// layout. A glyph is drawn at a page-aligned y by copying its page rows
+// straight into the display buffer. Cells are 6 * scale pixels wide and
+// 8 * scale high, like setTextSize(scale) text, so callers can lay the two
+// out the same way.
+
+#define BIG_FONT_MIN_SCALE 2
+#define BIG_FONT_MAX_SCALE 3
+
+bool big_font_has(char c);
+// y must be a multiple of 8; scale is 2 or 3. Overwrites the glyph's
+// 5 * scale columns, inverted for a white background.
+void big_font_draw(Adafruit_SSD1306 &disp, int16_t x, int16_t y, uint8_t scale, char c, bool invert);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Boot profiler and parallel bring-up.
+//
+// setup() is split into named stages: boot_stage() closes the running
+// stage and opens the next, timed with esp_timer_get_time(), which counts
+// from the start of the application (the ROM and second-stage bootloader
+// before it are not seen). boot_first_frame() marks the first clock frame
+// on the panel, the figure held to BOOT_FIRST_FRAME_TARGET_MS, and
+// boot_end() the end of setup().
+//
+// boot_spawn() runs a job that shares nothing with the loop task, such as
+// the bring-up of the peripherals on the other I2C bus, in a task on core
+// 0 while setup() goes on; boot_join() waits at most timeout_ms for it. A
+// job that overruns is left to finish on its own and whatever it brings
+// up is treated as missing. On the host jobs run inline.
+
+#define BOOT_MAX_STAGES 12
+#define BOOT_FIRST_FRAME_TARGET_MS 300
+#define BOOT_JOB_STACK 4096
+
+typedef bool (*boot_job_t)(void *arg); // true if the peripheral came up
+
+struct boot_stage_t
+{
+  const char *name;
+  uint32_t start_us; // since the application started
+  uint32_t us;
+  bool parallel; // a boot_spawn() job
+  bool ok;
+  bool timed_out;
+};
+
+void boot_begin();
+void boot_stage(const char *name);
+int boot_spawn(const char *name, boot_job_t job, void *arg);
+bool boot_join(int job, uint32_t timeout_ms);
+void boot_first_frame();
+void boot_end();
+
+int boot_stage_count();
+const boot_stage_t &boot_stage_info(int idx);
+uint32_t boot_first_frame_us();
+void boot_report(Print &out);
@@ -0,0 +1,39 @@
+#pragma once
+
+// Build-time feature selection.
+//
+// Every firmware target in the repository builds this one source tree;
+// its environment in platformio.ini, which extends [medibox], picks the
+// features with MEDIBOX_WITH_* flags. Code that uses an optional
+// subsystem branches on the constexpr switches below with `if constexpr`,
+// so a disabled feature's calls are discarded and need no definition, and
+// the environment's build_src_filter leaves the subsystem's sources out of
+// the build.
+//
+//   WIFI_TIME    NTP clock discipline (clock_sync); without it the clock
+//                starts at the build time and is set from the menu
+//   DISPLAY2     second OLED on I2C1
+//   CLIMATE      sensors and warnings on the second display (sensors,
+//                climate_sampler, climate_trend, climate_exposure,
+//                sensor_anomaly, dht_rmt)
+//   MULTI_ALARM  two alarms instead of one
+
+#ifndef MEDIBOX_WITH_WIFI_TIME
+#define MEDIBOX_WITH_WIFI_TIME 1
+#endif
+#ifndef MEDIBOX_WITH_DISPLAY2
+#define MEDIBOX_WITH_DISPLAY2 1
+#endif
+#ifndef MEDIBOX_WITH_CLIMATE
+#define MEDIBOX_WITH_CLIMATE 1
+#endif
+#ifndef MEDIBOX_WITH_MULTI_ALARM
+#define MEDIBOX_WITH_MULTI_ALARM 1
+#endif
+
+constexpr bool feature_wifi_time = MEDIBOX_WITH_WIFI_TIME;
+constexpr bool feature_display2 = MEDIBOX_WITH_DISPLAY2;
+constexpr bool feature_climate = MEDIBOX_WITH_CLIMATE;
+constexpr bool feature_multi_alarm = MEDIBOX_WITH_MULTI_ALARM;
+
+static_assert(!feature_climate || feature_display2, "the climate monitor needs the second display");
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Edge interrupts on the four push buttons. Each edge is recorded in the
+// input trace and published as an EVENT_BUTTON, which the display power
+// policy takes as user activity and gestures.h turns into the presses
+// the UI reads.
+
+void buttons_begin();
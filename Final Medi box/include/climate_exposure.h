@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Cumulative climate exposure of each compartment, per day, per week and
+// over its lifetime.
+//
+// Medicine storage is judged by mean kinetic temperature (MKT): the
+// constant temperature that would degrade the stock as much as the
+// temperatures it went through, with Arrhenius kinetics of activation
+// energy EXPOSURE_DELTA_H_R (ΔH/R). It only needs the time-weighted sum
+// of exp(-ΔH/RT), so each reading updates every period in O(1), as it does
+// the degree-minutes above temp_max and below temp_min and the %RH-minutes
+// above hum_max and below hum_min. The interval between two good readings
+// counts with the mean of its ends; after a failed read, while the sensor
+// is faulty (sensor_anomaly.h) or across a gap of more than
+// EXPOSURE_MAX_GAP_MS nothing is counted, so `seconds` is the time the
+// figures actually cover.
+//
+// Days and weeks (from Monday) follow local time and are only counted
+// once the clock is set. The totals live in the "exposure" NVS namespace,
+// one blob per compartment name, written every EXPOSURE_FLUSH_INTERVAL_MS
+// and when a day ends; a reboot loses at most that much.
+
+#define EXPOSURE_DELTA_H_R 10000.0 // K: 83.144 kJ/mol, the usual value for MKT
+#define EXPOSURE_MAX_GAP_MS (5UL * 60 * 1000)
+#define EXPOSURE_FLUSH_INTERVAL_MS (15UL * 60 * 1000)
+
+enum exposure_period_t : uint8_t
+{
+  EXPOSURE_DAY,
+  EXPOSURE_WEEK,
+  EXPOSURE_LIFETIME,
+  EXPOSURE_PERIODS
+};
+
+struct exposure_t
+{
+  uint32_t start;   // local day number it began on, 0 if unknown
+  double seconds;   // covered by readings
+  double arrhenius; // sum of exp(-ΔH/RT) dt, seconds
+  double temp_above, temp_below; // °C·min
+  double hum_above, hum_below;   // %RH·min
+  double hum_sum;   // %RH·s, for the mean
+};
+
+void climate_exposure_begin(); // after the sensors are added
+void climate_exposure_update(int sensor, float temp, float hum, unsigned long t_ms);
+void climate_exposure_flush(bool force);
+const exposure_t &climate_exposure(int sensor, exposure_period_t period);
+float exposure_mkt(const exposure_t &e);      // °C, NAN without readings
+float exposure_hum_mean(const exposure_t &e); // %RH, NAN without readings
+const char *exposure_period_name(exposure_period_t period);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include "climate_trend.h"
+
+// Adaptive climate sampling, one sampler per sensor.
+//
+// Every read costs sensor self-heating and bus time, so a sampler reads
+// as rarely as the readings allow: it backs off to climate_max_latency_ms
+// while values are stable and inside its limits, tightens as the trend
+// approaches a limit (aiming for several samples before the predicted
+// crossing), and takes a burst at the minimum period after a failed read
+// or a limit crossing. The interval never exceeds climate_max_latency_ms,
+// which bounds the worst-case detection latency.
+//
+// The same trends forecast the crossings: climate_sampler_forecast()
+// reports the earliest one due within climate_forecast_horizon_s, if the
+// slope is steep enough with climate_forecast_z standard errors taken off.
+
+#define SAMPLER_MIN_INTERVAL_MS 2000 // DHT22 minimum sampling period
+#define SAMPLER_BURST_COUNT 3
+#define SAMPLER_SAMPLES_BEFORE_CROSSING 4
+#define SAMPLER_FORECAST_MIN_SAMPLES 5 // before a trend is trusted to warn
+
+struct climate_limits_t
+{
+  float temp_min, temp_max;
+  float hum_min, hum_max;
+};
+
+extern const climate_limits_t climate_default_limits;
+extern unsigned long climate_max_latency_ms;
+extern unsigned long climate_forecast_horizon_s;
+extern float climate_forecast_z; // confidence, in standard errors of the slope
+
+enum climate_channel_t : uint8_t
+{
+  CLIMATE_TEMP,
+  CLIMATE_HUM
+};
+
+struct climate_forecast_t
+{
+  uint8_t channel; // climate_channel_t
+  float limit;     // the one to be crossed
+  float seconds;
+};
+
+struct climate_sampler_stats_t
+{
+  uint32_t reads;
+  uint32_t failed;
+  uint32_t bursts;
+  unsigned long interval_ms; // currently scheduled interval
+};
+
+struct climate_sampler_t
+{
+  climate_limits_t limits;
+  unsigned long next_sample_ms;
+  bool sampled_once;
+  climate_trend_t temp_trend, hum_trend;
+  bool last_in_range;
+  uint8_t burst_left;
+  climate_sampler_stats_t stats;
+};
+
+void climate_sampler_init(climate_sampler_t &s, const climate_limits_t &limits);
+bool climate_in_range(const climate_limits_t &limits, float temp, float hum);
+bool climate_sampler_due(const climate_sampler_t &s, unsigned long now_ms);
+void climate_sampler_update(climate_sampler_t &s, float temp, float hum, unsigned long now_ms);
+bool climate_sampler_forecast(const climate_sampler_t &s, climate_forecast_t *f);
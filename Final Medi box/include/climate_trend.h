@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Trend of one climate channel: Holt's linear (double exponential)
+// smoothing, for samples at irregular intervals.
+//
+// Each sample updates a smoothed level and slope in O(1). The smoothing
+// weights come from time constants rather than sample counts, so a burst
+// of closely spaced reads weighs no more than one read over the same
+// time. The estimator also tracks how much the slope moves from sample to
+// sample, which gives the slope's standard error: a crossing is only
+// predicted with the confidence asked for if even the slope that many
+// standard errors flatter gets there.
+
+#define TREND_LEVEL_TAU_S 60.0f
+#define TREND_SLOPE_TAU_S 180.0f
+
+struct climate_trend_t
+{
+  float level;
+  float slope;     // units per second
+  float slope_var; // of the slope seen between samples around the smoothed one
+  float gain;      // slope weight of the last update
+  unsigned long last_ms;
+  uint16_t samples;
+};
+
+void climate_trend_update(climate_trend_t &t, float value, unsigned long now_ms);
+float climate_trend_slope_se(const climate_trend_t &t);
+// Seconds until the level leaves [lo, hi], with the slope taken z standard
+// errors closer to flat; 0 if already outside, INFINITY if not heading out
+float climate_trend_seconds_to(const climate_trend_t &t, float lo, float hi, float z);
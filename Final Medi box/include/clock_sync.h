@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include <sys/time.h>
+
+// Clock discipline over NTP.
+//
+// A sync queries every server in clock_servers a few times and keeps the
+// sample with the lowest round-trip time, whose offset is the least
+// distorted by queueing. The first sync, or an offset beyond
+// CLOCK_STEP_US, steps the clock and calls the adjust callback; anything
+// smaller is slewed with adjtime() so local time never jumps and alarms
+// neither skip nor repeat a second.
+//
+// The offset left after a slewed interval is what the oscillator drifted;
+// it trims a drift estimate (ppm) that is slewed in every minute between
+// syncs. While the residual stays under CLOCK_GOOD_US the resync interval
+// doubles up to CLOCK_MAX_INTERVAL_MS, and it halves when the residual
+// exceeds CLOCK_POOR_US. WiFi is only switched on for a sync.
+//
+// clock_sync_update() runs one step per call from the main loop: connect,
+// wait for the server names to resolve, one query (blocking at most
+// CLOCK_REPLY_TIMEOUT_MS), or apply. Names are looked up asynchronously
+// once per sync, right after WiFi connects, and queries go to the cached
+// addresses; a server whose lookup has not answered within
+// CLOCK_RESOLVE_TIMEOUT_MS keeps its last known address, or is skipped.
+
+#define CLOCK_SAMPLES_PER_SERVER 2
+#define CLOCK_REPLY_TIMEOUT_MS 250
+#define CLOCK_CONNECT_TIMEOUT_MS 20000
+#define CLOCK_RESOLVE_TIMEOUT_MS 5000
+#define CLOCK_STEP_US 1000000 // larger offsets are stepped, not slewed
+#define CLOCK_GOOD_US 20000
+#define CLOCK_POOR_US 100000
+#define CLOCK_MIN_INTERVAL_MS (15UL * 60 * 1000)
+#define CLOCK_MAX_INTERVAL_MS (8UL * 60 * 60 * 1000)
+#define CLOCK_RETRY_MS (5UL * 60 * 1000) // after a failed sync
+#define CLOCK_DRIFT_STEP_MS 60000
+#define CLOCK_MAX_DRIFT_PPM 200.0f
+
+extern const char *clock_servers[];
+
+typedef void (*clock_adjust_cb_t)(struct timeval *tv);
+
+struct clock_sync_stats_t
+{
+  bool synced;
+  uint32_t syncs;
+  uint32_t failed;
+  uint32_t steps;
+  int32_t last_offset_us; // correction applied by the last sync
+  uint32_t last_rtt_us;   // of the sample it used
+  float drift_ppm;        // slewed in between syncs, + = local clock slow
+  unsigned long interval_ms;
+  unsigned long radio_on_ms; // total WiFi on time
+};
+
+// Switches WiFi on and returns; the first sync runs once it has connected
+void clock_sync_begin(const char *ssid, const char *password, int channel, clock_adjust_cb_t on_adjust);
+void clock_sync_update();
+void clock_set_utc_offset(long seconds);
+const clock_sync_stats_t &clock_sync_stats();
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include "input_trace.h"
+
+// Post-mortem context kept across a reboot.
+//
+// A panic (exception, abort, task watchdog) or an esp_restart() writes a
+// fixed-size record into RTC slow memory: what happened, where, a short
+// backtrace, the newest input trace records and the alarm scheduler's
+// state. The panic hook wraps esp_panic_handler (-Wl,--wrap in
+// platformio.ini) and runs before the core dump and reboot, so the capture
+// only copies into static RTC memory: no allocation, no locks and nothing
+// in flash. The next boot validates the record by its checksum, prints it
+// and keeps it for the 'X' console command.
+
+#define CRASH_BACKTRACE_DEPTH 12
+#define CRASH_TRACE_RECORDS 16
+#define CRASH_ALARMS 2
+
+enum crash_cause_t : uint8_t
+{
+  CRASH_NONE,
+  CRASH_PANIC,
+  CRASH_RESTART // esp_restart(), e.g. a health fault
+};
+
+struct crash_alarm_t
+{
+  int64_t next_due;
+  int64_t last_due;
+  int64_t snooze_due;
+  uint8_t alarm_state;
+  uint8_t snooze_count;
+};
+
+struct crash_context_t
+{
+  uint32_t magic;
+  uint8_t cause;
+  uint8_t reset_reason; // esp_reset_reason_t of the boot that found it
+  uint8_t backtrace_depth;
+  uint8_t trace_count;
+  uint32_t uptime_ms;
+  uint32_t exc_cause; // Xtensa EXCCAUSE, panics only
+  uint32_t exc_vaddr;
+  uint32_t backtrace[CRASH_BACKTRACE_DEPTH]; // PCs, innermost first
+  trace_record_t trace[CRASH_TRACE_RECORDS];
+  crash_alarm_t alarms[CRASH_ALARMS];
+  uint32_t crc;
+};
+
+void crash_begin();
+bool crash_last(crash_context_t *out);
+void crash_report(Print &out);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Non-blocking DHT22 driver on the RMT receiver.
+//
+// request() hands the transaction to a small driver task, which sends the
+// start pulse with vTaskDelay(), lets the RMT peripheral capture the
+// sensor's 40-bit pulse train and decodes it when capture ends. Nothing
+// busy-waits and interrupts stay enabled. The result is published as the
+// latest reading and passed to the optional completion callback (called
+// from the driver task). getTemperature()/getHumidity() keep the DHTesp
+// names and return that latest reading.
+
+struct dht_reading_t
+{
+  float temperature;
+  float humidity;
+  bool ok;
+  unsigned long t_ms;
+};
+
+typedef void (*dht_callback_t)(const dht_reading_t &reading);
+
+class DhtRmt
+{
+public:
+  enum DHT_MODEL_t
+  {
+    DHT22
+  };
+
+  bool setup(uint8_t pin, DHT_MODEL_t model = DHT22);
+  void onReading(dht_callback_t callback) { callback_ = callback; }
+  bool request();
+  bool available();
+  dht_reading_t lastReading();
+  float getTemperature() { return lastReading().temperature; }
+  float getHumidity() { return lastReading().humidity; }
+  int getMinimumSamplingPeriod() { return 2000; }
+
+  // Driver task side
+  void complete(const dht_reading_t &reading);
+
+private:
+  uint8_t pin_ = 0;
+  void *task_ = nullptr;
+  void *ringbuf_ = nullptr;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  volatile bool busy_ = false;
+  volatile bool fresh_ = false;
+  dht_reading_t reading_ = {NAN, NAN, false, 0};
+  unsigned long last_request_ms_ = 0;
+  bool requested_once_ = false;
+  dht_callback_t callback_ = nullptr;
+
+  friend void dht_rmt_task(void *arg);
+};
+
+bool dht_decode(const uint8_t data[5], float *temperature, float *humidity);
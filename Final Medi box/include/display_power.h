@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+
+// Display power policy for the two OLEDs.
+//
+// A panel is dimmed through the SSD1306 contrast register after
+// display_dim_after_ms without activity and switched off (DISPLAYOFF, the
+// panel keeps its RAM) after display_off_after_ms. A button or alarm event
+// (see events.h), taken in display_power_update(), or display_power_wake()
+// brings both back at once. While a panel is off callers skip rendering
+// for it and panel_flush() drops the I2C transfer.
+//
+// panel_flush_pages() sends only a column range of each page that
+// changed, for the retained-mode screens in ui.h, as far as the pass's
+// bus time allows (see i2c_bus.h). It needs the panel's bus from
+// panel_set_bus().
+//
+// A panel that did not answer at boot is marked with panel_set_absent():
+// it counts as never visible, so nothing is rendered or sent to it and
+// the rest of the firmware runs on without it.
+
+// One display(): 1 KiB of GDDRAM plus page/column setup, control bytes
+// and addressing for the 128-byte Wire chunks
+#define SSD1306_FLUSH_BYTES (1024 + 8 + 2 * 9)
+#define SSD1306_WINDOW_BYTES 8 // address, control byte, COLUMNADDR and PAGEADDR
+#define SSD1306_CHUNK_BYTES 2  // address and data control byte per Wire transmission
+
+enum panel_power_t : uint8_t
+{
+  PANEL_ON,
+  PANEL_DIMMED,
+  PANEL_OFF
+};
+
+struct panel_stats_t
+{
+  panel_power_t state;
+  bool absent;
+  unsigned long on_ms; // lit (on or dimmed) time so far
+  uint32_t flushes;
+  uint32_t partial; // of which only changed pages were sent
+  uint32_t skipped; // flushes dropped while off
+  uint32_t bytes;   // estimated I2C bytes sent
+};
+
+extern unsigned long display_dim_after_ms;
+extern unsigned long display_off_after_ms;
+
+void display_power_begin(Adafruit_SSD1306 *panel1, Adafruit_SSD1306 *panel2);
+void display_power_update();
+void display_power_wake();
+bool panel_visible(Adafruit_SSD1306 &disp);
+void panel_flush(Adafruit_SSD1306 &disp);
+void panel_set_bus(Adafruit_SSD1306 &disp, TwoWire *wire, uint8_t addr);
+void panel_set_absent(Adafruit_SSD1306 &disp);
+void panel_flush_pages(Adafruit_SSD1306 &disp, uint8_t col_lo[8], uint8_t col_hi[8], bool budgeted);
+panel_stats_t panel_stats(int idx);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Publish/subscribe between ISRs, tasks and the main loop.
+//
+// Events are fixed 16-byte values copied into preallocated rings, so
+// nothing is allocated at runtime. Every subscriber has one ring per
+// producer context (button ISR, main loop), which keeps each ring
+// single-producer/single-consumer and lets it run on two atomic indices
+// without locks; event_publish() is therefore safe from an ISR. Ordering
+// is FIFO per producer only. A full ring drops the new event and counts
+// it. Subscribe during setup(), before anything publishes; a subscription
+// past EVENT_MAX_SUBSCRIBERS is logged as an error and returns -1, which
+// receives nothing.
+
+#define EVENT_RING_SIZE 16 // power of two
+#define EVENT_MAX_SUBSCRIBERS 8 // six used in the full build
+
+enum event_type_t : uint8_t
+{
+  EVENT_BUTTON, // arg = pin, value[0] = level
+  EVENT_TICK,   // value[0] = local seconds of the new second
+  EVENT_SAMPLE, // arg = sensor, reading = temperature, humidity (NaN if failed)
+  EVENT_ALARM,  // arg = alarm, value[0] = due (local seconds)
+  EVENT_CONFIG, // arg = config_key_t
+  EVENT_CLOCK,  // value[0] = epoch seconds after a clock step
+  EVENT_DOSE,   // arg = alarm, extra = dose_action_t, value[0] = due, value[1] = latency (s)
+  EVENT_TYPES
+};
+
+#define EVENT_MASK(type) (1u << (type))
+
+enum event_producer_t : uint8_t
+{
+  PRODUCER_ISR,
+  PRODUCER_LOOP,
+  EVENT_PRODUCERS
+};
+
+enum config_key_t : uint8_t
+{
+  CONFIG_TIME_ZONE,
+  CONFIG_ALARM, // value[0] = alarm index
+  CONFIG_SNOOZE
+};
+
+struct event_t
+{
+  uint8_t type;
+  uint8_t arg;
+  uint16_t extra; // type-specific
+  uint32_t t_ms;
+  union
+  {
+    int32_t value[2];
+    float reading[2];
+  };
+};
+
+struct event_ring_stats_t
+{
+  uint32_t published;
+  uint32_t dropped;
+  uint16_t high_water; // deepest the ring has been
+};
+
+int event_subscribe(const char *name, uint32_t type_mask);
+void event_publish(event_producer_t producer, uint8_t type, uint8_t arg, int32_t v0, int32_t v1 = 0, uint16_t extra = 0);
+void event_publish_reading(event_producer_t producer, uint8_t type, uint8_t arg, float r0, float r1);
+bool event_poll(int subscriber, event_t *e);
+
+int event_subscriber_count();
+const char *event_subscriber_name(int subscriber);
+event_ring_stats_t event_stats(int subscriber, event_producer_t producer);
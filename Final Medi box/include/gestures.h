@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Gesture recognizer over the button events.
+//
+// A press is reported on the pressing edge, so recognition adds no
+// latency: GESTURE_PRESS as soon as a button goes down, then, while Up or
+// Down stays held, GESTURE_REPEAT after GESTURE_REPEAT_DELAY_MS at an
+// interval that halves every GESTURE_ACCEL_EVERY repeats down to
+// GESTURE_REPEAT_MIN_MS. OK and Cancel do not repeat; held past
+// GESTURE_LONG_MS they report one GESTURE_LONG (a long Cancel leaves the
+// menu from any depth; a long OK has no use yet). Pressing Down while Up is
+// held, or the other way round, is a GESTURE_CHORD, and the held button
+// stops repeating.
+//
+// Each gesture carries the step a numeric editor applies: +1/-1 for Up
+// and Down presses and repeats, GESTURE_CHORD_STEP in the held button's
+// direction for a chord, 0 for OK and Cancel. The first chord of a hold
+// takes back the held button's own press, so Up then Down is exactly +10.
+//
+// Timing comes from the edge timestamps and millis(), never from delays.
+// gesture_next() runs the recognizer and is polled by whatever waits for
+// input; an edge within GESTURE_DEBOUNCE_MS of the last accepted one on
+// the same button is contact bounce.
+
+#define GESTURE_DEBOUNCE_MS 20
+#define GESTURE_LONG_MS 800
+#define GESTURE_REPEAT_DELAY_MS 400
+#define GESTURE_REPEAT_START_MS 160
+#define GESTURE_REPEAT_MIN_MS 40
+#define GESTURE_ACCEL_EVERY 5
+#define GESTURE_CHORD_STEP 10
+#define GESTURE_QUEUE 8
+
+enum gesture_type_t : uint8_t
+{
+  GESTURE_PRESS,
+  GESTURE_REPEAT,
+  GESTURE_LONG,
+  GESTURE_CHORD // button = the one pressed second
+};
+
+struct gesture_t
+{
+  uint8_t type;
+  uint8_t button; // pin
+  int8_t step;
+  uint32_t t_ms;
+};
+
+void gestures_begin();
+bool gesture_next(gesture_t *g);
+// Drop what is queued; buttons still held give nothing more until released
+void gesture_clear();
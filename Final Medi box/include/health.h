@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Runtime health monitor.
+//
+// The loop task is registered with the task watchdog; health_update() feeds
+// it from the main loop and from every blocking UI loop, so a hang anywhere
+// else panics and reboots after HEALTH_WDT_TIMEOUT_S. Once a second it also
+// samples the stack high-water mark of the firmware's tasks and the heap:
+// total free, the all-time minimum and the largest free block, whose ratio
+// to the free total is the fragmentation figure.
+//
+// A limit breach or health_fault() records the cause in RTC memory and
+// restarts. The boot after that, or after a watchdog or panic reset, runs
+// in safe mode: optional peripherals are left out and faults are only
+// reported, so a persistent fault cannot boot-loop the alarms away.
+
+#define HEALTH_WDT_TIMEOUT_S 8
+#define HEALTH_CHECK_MS 1000
+#define HEALTH_MIN_STACK_BYTES 256    // free stack a task must keep
+#define HEALTH_MIN_FREE_HEAP 8192
+#define HEALTH_MIN_LARGEST_BLOCK 4096 // a fragmented heap fails allocations first
+
+enum health_fault_t : uint8_t
+{
+  HEALTH_OK,
+  HEALTH_WATCHDOG, // task or interrupt watchdog reset
+  HEALTH_CRASH,    // panic reset
+  HEALTH_STACK,
+  HEALTH_HEAP,
+  HEALTH_FRAGMENTED,
+  HEALTH_DISPLAY
+};
+
+struct health_task_t
+{
+  const char *name;
+  void *handle; // TaskHandle_t, nullptr if the task does not exist
+  uint32_t stack_free; // high-water mark in bytes
+};
+
+struct health_stats_t
+{
+  uint32_t free_heap;
+  uint32_t min_free_heap;
+  uint32_t largest_block;
+  uint8_t fragmentation_pct; // 100 - largest block / free heap
+  uint32_t max_feed_gap_ms;  // longest stretch without health_update()
+  health_fault_t last_fault; // cause of the previous restart, if any
+};
+
+void health_begin();
+void health_update();
+bool health_safe_mode();
+void health_fault(health_fault_t fault); // returns only in safe mode
+void health_halt();                      // blink the LED forever
+const char *health_fault_name(health_fault_t fault);
+
+const health_stats_t &health_stats();
+int health_task_count();
+const health_task_t &health_task(int idx);
+void health_report(Print &out);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Wire.h>
+
+// Bus time sharing between the OLEDs and the I2C sensors.
+//
+// Each OLED shares its bus (Wire, Wire1) with sensors. bus_begin_pass()
+// at the top of loop() opens a fresh BUS_SLICE_US of bus time per bus.
+// Sensor transactions run first in the pass and are a few bytes each;
+// display pages are then sent while the slice lasts and the rest carry
+// over to the next pass. A pass always sends at least one page and a
+// sensor phase only waits while the slice is used up, so neither side
+// can starve the other. Blocking screens flush in full and are charged
+// but not limited.
+
+#define BUS_SLICE_US 4000
+
+enum bus_user_t : uint8_t
+{
+  BUS_DISPLAY,
+  BUS_SENSOR
+};
+
+struct bus_stats_t
+{
+  uint32_t display_us;
+  uint32_t sensor_us;
+  uint32_t display_deferred; // passes that carried display pages over
+  uint32_t sensor_deferred;  // sensor phases pushed to a later pass
+  uint32_t max_pass_us;
+};
+
+void bus_begin_pass();
+bool bus_available(TwoWire *wire, bus_user_t user);
+void bus_charge(TwoWire *wire, bus_user_t user, uint32_t us);
+const bus_stats_t &bus_stats(int idx); // 0 = Wire, 1 = Wire1
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Record-and-replay of device inputs.
+//
+// Every input the firmware reacts to (button edges, DHT readings and NTP
+// clock adjustments) is logged with its millis() timestamp into a fixed
+// ring buffer. The ring can be dumped over serial ('T' on the console,
+// extracted from the telemetry stream with tools/telemetry --text) and the
+// dump fed to the host replay driver in tools/replay, which drives the
+// same setup()/loop() with those inputs in virtual time.
+
+#define TRACE_CAPACITY 256
+#define TRACE_SENSORS 4 // climate sensors with their own base record
+
+enum trace_kind_t : uint8_t
+{
+  TRACE_BUTTON = 'B',  // arg = pin, a = level
+  TRACE_CLIMATE = 'C', // arg = sensor << 1 | failed, a = temp * 10, b = humidity * 10
+  TRACE_CLOCK = 'N'    // b = epoch seconds after the adjustment
+};
+
+struct trace_record_t
+{
+  uint32_t t_ms;
+  uint8_t kind;
+  uint8_t arg;
+  int16_t a;
+  int32_t b;
+};
+
+void trace_record_button(uint8_t pin, uint8_t level);
+void trace_record_climate(uint8_t sensor, float temp, float hum);
+void trace_record_clock(uint32_t epoch);
+void trace_dump(Print &out);
+// Newest records, oldest first, without taking the lock: for the panic
+// path, where the lock may be held by the code that crashed
+int trace_copy_latest(trace_record_t *out, int max);
+void trace_print_record(Print &out, const trace_record_t &rec);
+
+// Dump parsing, shared with the host replay driver
+bool trace_parse_line(const char *line, trace_record_t &rec);
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <Arduino.h>
+#include <type_traits>
+
+// Asynchronous leveled logging.
+//
+// LOG_E/W/I/D(fmt, ...) capture the format and up to LOG_MAX_ARGS
+// arguments into a lock-free ring and return; a low-priority task formats
+// them and sends them as telemetry log records once the UART has room.
+// A full ring drops the message and counts it, so logging never blocks
+// the caller. Every call site keeps its own rate limit
+// (LOG_SITE_INTERVAL_MS, or LOG_EVERY for another interval); suppressed
+// messages are counted and reported with the next one that gets through.
+//
+// Levels above LOG_LEVEL compile to nothing. Release builds keep INFO;
+// build with -DLOG_LEVEL=LOG_LEVEL_DEBUG for the debug logs.
+//
+// Formatting is deferred, so %s arguments must outlive the call: string
+// literals and other static strings only.
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_SIZE 32 // power of two
+#define LOG_MAX_ARGS 4
+#define LOG_SITE_INTERVAL_MS 1000
+#define LOG_DRAIN_MS 20
+
+struct log_site_t
+{
+  uint8_t level;
+  const char *fmt;
+  uint32_t interval_ms;
+  uint32_t last_ms;
+  uint32_t suppressed; // since the last message that got through
+  bool logged;
+};
+
+enum log_arg_kind_t : uint8_t
+{
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_STR
+};
+
+struct log_arg_t
+{
+  uint8_t kind;
+  union
+  {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char *s;
+  };
+};
+
+struct log_stats_t
+{
+  uint32_t written;
+  uint32_t dropped;    // ring full
+  uint32_t suppressed; // rate limited
+  uint16_t high_water;
+};
+
+// Never called: lets the compiler check the format against the arguments
+void log_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+void log_begin();
+bool log_admit(log_site_t &site); // rate limit
+void log_submit(log_site_t &site, const log_arg_t *args, uint8_t n_args);
+const log_stats_t &log_stats();
+
+inline log_arg_t log_arg(const char *s)
+{
+  log_arg_t a;
+  a.kind = LOG_ARG_STR;
+  a.s = s;
+  return a;
+}
+
+template <typename T>
+log_arg_t log_arg(T v)
+{
+  static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "log arguments are numbers or static strings");
+  log_arg_t a;
+  if constexpr (std::is_floating_point<T>::value)
+  {
+    a.kind = LOG_ARG_DOUBLE;
+    a.d = v;
+  }
+  else if constexpr (std::is_enum<T>::value || std::is_signed<T>::value)
+  {
+    a.kind = LOG_ARG_INT;
+    a.i = (int64_t)v;
+  }
+  else
+  {
+    a.kind = LOG_ARG_UINT;
+    a.u = (uint64_t)v;
+  }
+  return a;
+}
+
+template <typename... A>
+void log_post(log_site_t &site, A... args)
+{
+  static_assert(sizeof...(A) <= LOG_MAX_ARGS, "too many log arguments");
+  if (!log_admit(site))
+    return;
+  log_arg_t captured[sizeof...(A) + 1] = {log_arg(args)...};
+  log_submit(site, captured, sizeof...(A));
+}
+
+#define LOG_EVERY(interval_ms, level, fmt, ...)                                 \
+  do                                                                            \
+  {                                                                             \
+    static log_site_t log_site_ = {level, fmt, interval_ms, 0, 0, false};      \
+    if (false)                                                                  \
+      log_check_format(fmt, ##__VA_ARGS__);                                     \
+    log_post(log_site_, ##__VA_ARGS__);                                         \
+  } while (0)
+
+#define LOG_AT(level, fmt, ...) LOG_EVERY(LOG_SITE_INTERVAL_MS, level, fmt, ##__VA_ARGS__)
+
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) do {} while (0)
+#endif
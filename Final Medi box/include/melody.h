@@ -0,0 +1,185 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Melodies in RTTTL notation, parsed at compile time.
+//
+//   "name:d=4,o=5,b=120:c,8e.,g,p,2c6"
+//
+// The defaults section gives the note length (d), octave (o) and tempo in
+// beats per minute (b); each note is an optional length, a-g or p for a
+// pause, an optional # and dot, and an optional octave. MELODY() turns
+// such a literal into a melody_t of packed notes, 16 bits each, when the
+// result is a constexpr variable: a syntax error fails the build, and
+// the notes end up in flash. tune_t points at them for playback, which
+// reads the packed form directly.
+
+#define MELODY_GAP_MS 50 // the alarm leaves after every note, so repeated notes stay apart
+
+// Packed note: semitone from C in bits 0-3 (MELODY_PAUSE for a rest),
+// octave in bits 4-6, log2 of the length in bits 7-9, dotted in bit 10
+#define MELODY_PAUSE 15
+
+template <int N>
+struct melody_t
+{
+  uint16_t bpm;
+  uint16_t notes[N];
+};
+
+struct tune_t
+{
+  const char *name;
+  uint16_t bpm;
+  uint16_t n_notes;
+  const uint16_t *notes;
+};
+
+// Not defined: reached only while parsing a malformed melody, which makes
+// the constant expression, and the build, fail here
+void melody_syntax_error();
+
+constexpr bool melody_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+constexpr const char *melody_skip_spaces(const char *p)
+{
+  while (*p == ' ')
+    p++;
+  return p;
+}
+
+// Start of the notes section, after the second ':'
+constexpr const char *melody_notes(const char *text)
+{
+  int colons = 0;
+  while (*text != 0 && colons < 2)
+    if (*text++ == ':')
+      colons++;
+  if (colons < 2)
+    melody_syntax_error();
+  return text;
+}
+
+constexpr int melody_count(const char *text)
+{
+  const char *p = melody_notes(text);
+  int n = *melody_skip_spaces(p) != 0 ? 1 : 0;
+  for (; *p != 0; p++)
+    if (*p == ',')
+      n++;
+  return n;
+}
+
+constexpr int melody_number(const char *&p)
+{
+  int v = 0;
+  if (!melody_digit(*p))
+    melody_syntax_error();
+  while (melody_digit(*p))
+    v = v * 10 + (*p++ - '0');
+  return v;
+}
+
+constexpr uint16_t melody_length_code(int length)
+{
+  for (uint16_t code = 0; code <= 5; code++)
+    if (length == 1 << code)
+      return code;
+  melody_syntax_error(); // lengths are 1, 2, 4, 8, 16 or 32
+  return 0;
+}
+
+template <int N>
+constexpr melody_t<N> melody_parse(const char *text)
+{
+  melody_t<N> m = {};
+  int length = 4, octave = 6, bpm = 63; // RTTTL's defaults
+
+  // Defaults section: d=, o= and b= in any order
+  const char *p = text;
+  while (*p != ':')
+    p++;
+  p++;
+  while (*p != ':')
+  {
+    p = melody_skip_spaces(p);
+    char key = *p++;
+    if (*p++ != '=')
+      melody_syntax_error();
+    int v = melody_number(p);
+    if (key == 'd')
+      length = v;
+    else if (key == 'o')
+      octave = v;
+    else if (key == 'b')
+      bpm = v;
+    else
+      melody_syntax_error();
+    p = melody_skip_spaces(p);
+    if (*p == ',')
+      p++;
+    else if (*p != ':')
+      melody_syntax_error();
+  }
+  p++;
+  m.bpm = bpm;
+
+  constexpr int semitones[] = {9, 11, 0, 2, 4, 5, 7}; // a to g
+  for (int i = 0; i < N; i++)
+  {
+    p = melody_skip_spaces(p);
+    int note_length = melody_digit(*p) ? melody_number(p) : length;
+    int semitone = MELODY_PAUSE;
+    if (*p == 'p')
+      p++;
+    else if (*p >= 'a' && *p <= 'g')
+      semitone = semitones[*p++ - 'a'];
+    else
+      melody_syntax_error();
+    if (*p == '#')
+    {
+      if (semitone == MELODY_PAUSE || semitone == 11)
+        melody_syntax_error(); // b# would be the next octave's c
+      semitone++;
+      p++;
+    }
+    bool dotted = false;
+    if (*p == '.')
+    {
+      dotted = true;
+      p++;
+    }
+    int note_octave = melody_digit(*p) ? melody_number(p) : octave;
+    if (*p == '.')
+    {
+      dotted = true;
+      p++;
+    }
+    if (note_octave > 7)
+      melody_syntax_error();
+    m.notes[i] = semitone | note_octave << 4 | melody_length_code(note_length) << 7 | (dotted ? 1 << 10 : 0);
+    p = melody_skip_spaces(p);
+    if (*p == ',')
+      p++;
+    else if (*p != 0)
+      melody_syntax_error();
+  }
+  return m;
+}
+
+#define MELODY(text) melody_parse<melody_count(text)>(text)
+
+// A tune_t over a constexpr melody_t
+#define TUNE(name, melody) {name, (melody).bpm, sizeof((melody).notes) / sizeof(uint16_t), (melody).notes}
+
+extern const tune_t tunes[];
+extern const int n_tunes;
+extern const tune_t warning_tune;  // a climate limit is crossed
+extern const tune_t fault_tune;    // a climate sensor is faulty
+extern const tune_t forecast_tune; // a climate limit will be crossed soon
+
+uint16_t melody_note_hz(uint16_t note); // 0 for a pause
+uint32_t melody_note_ms(uint16_t note, uint16_t bpm);
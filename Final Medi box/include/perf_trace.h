@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Timeline tracing: what ran when, event by event.
+//
+// perf_begin() / perf_end() mark a slice and perf_instant() a point in
+// time, each with a name and a number. Recording is lock-free and safe in
+// ISRs: the CPU cycle counter, esp_timer_get_time(), an atomic slot
+// increment and a 16-byte store into a ring of PERF_TRACE_CAPACITY
+// events, around a microsecond.
+// Names are only pointed to, so they must be string literals.
+//
+// Cycle counts are per core and wrap every 17.9 s at 240 MHz, so an event
+// recorded more than PERF_ANCHOR_US after its core's last anchor (its
+// cycle count against esp_timer microseconds) records a new one first;
+// the dump turns cycles into microseconds from the anchor before each
+// event. Events whose anchor has been overwritten in the ring cannot be
+// timed and are left out. The dump ('F' on the console) pauses recording
+// while it prints, oldest first:
+//
+//   # medibox-perf v1 events=<n> overwritten=<n> skipped=<n> untimed=<n>
+//   <B|E|I>,<t_us>,<context>,<arg>,<name>
+//   # end
+//
+// where context is the core, plus PERF_CTX_ISR in an interrupt handler.
+// tools/perf_check records across a counter wrap and checks the dump.
+// tools/perf_trace turns a dump into Chrome trace JSON for Perfetto.
+
+#define PERF_TRACE_CAPACITY 512 // a power of two
+#define PERF_ANCHOR_US 1000000
+#define PERF_CTX_ISR 2
+
+enum perf_type_t : uint8_t
+{
+  PERF_BEGIN = 'B',
+  PERF_END = 'E',
+  PERF_INSTANT = 'I',
+  PERF_ANCHOR = 'A' // arg = esp_timer microseconds
+};
+
+void perf_begin(const char *name, uint32_t arg = 0);
+void perf_end(const char *name, uint32_t arg = 0);
+void perf_instant(const char *name, uint32_t arg = 0);
+// Ends the loop's current stage and begins the next (nullptr: none)
+void perf_stage(const char *name);
+void perf_trace_dump(Print &out);
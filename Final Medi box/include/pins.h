@@ -0,0 +1,13 @@
+#pragma once
+
+#define Buzzer 18
+#define LED 19
+#define PB_Cancel 23
+#define PB_OK 2
+#define PB_Up 4
+#define PB_Down 5
+#define DHT22_PIN 16
+#define I2C0_SDA 21 // OLED1
+#define I2C0_SCL 22 // OLED1
+#define I2C1_SDA 12 // OLED2
+#define I2C1_SCL 13 // OLED2
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Dose schedules and next-due calculation.
+//
+// All times are local seconds since 1970-01-01 (epoch + UTC offset), so a
+// day number is local_sec / 86400 and weekdays follow struct tm (0 = Sun).
+// next-due is computed arithmetically: at most 7 day probes for weekly
+// schedules and a single division for interval schedules.
+
+#define SCHEDULE_NEVER INT64_MAX
+#define SCHEDULE_EVERY_DAY 0x7F
+#define SCHEDULE_OPEN_END INT32_MAX
+
+enum schedule_kind_t : uint8_t
+{
+  SCHEDULE_WEEKLY,  // at start_minute on every day set in days_mask
+  SCHEDULE_INTERVAL // every interval_min minutes from start_minute on first_day
+};
+
+struct dose_schedule_t
+{
+  uint8_t kind;
+  uint8_t days_mask;     // bit n = weekday n, SCHEDULE_WEEKLY only
+  uint16_t start_minute; // minute of the day of the first dose
+  uint16_t interval_min; // SCHEDULE_INTERVAL only
+  int32_t first_day;     // local day number the regimen starts on
+  int32_t last_day;      // inclusive, SCHEDULE_OPEN_END if open-ended
+};
+
+dose_schedule_t schedule_daily(int hours, int minutes);
+int64_t schedule_next_due(const dose_schedule_t &s, int64_t now);
+
+// Calendar helpers
+int64_t local_seconds(int year, int month, int day, int hours, int minutes, int seconds);
+int weekday_of_day(int32_t day);
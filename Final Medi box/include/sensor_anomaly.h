@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Online fault detection, one detector per sensor.
+//
+// A sensor can fail while its readings stay inside the limits: frozen at
+// one value, jumping about, or failing most reads. The detector sees
+// every completed read and keeps a fixed few words per sensor. For each
+// channel it learns how much each step between good readings differs
+// from the step before, with Welford's running mean and variance
+// forgetting all but about the last ANOMALY_WINDOW of them, and runs a
+// CUSUM change-point test on them for a rise in their spread. A steady
+// trend changes its steps little; a failing sensor's noise does. It flags
+//
+//   stuck    both channels exactly unchanged for ANOMALY_STUCK_READS reads
+//            and at least ANOMALY_STUCK_MS; live air is never that still
+//   jump     a step no compartment can make in the time since the last
+//            good reading; the outlier is not learned
+//   erratic  the CUSUM finds the changes have grown well beyond their
+//            usual spread and stayed there for several reads; outliers are
+//            not learned, so a sensor that stays wild stays flagged
+//   failing  ANOMALY_MAX_FAILED of the last ANOMALY_READS reads failed
+//
+// A fault holds until ANOMALY_CLEAR_READS good reads in a row pass every
+// test. It is separate from the range check: a faulty sensor's readings
+// say nothing about its compartment.
+
+#define ANOMALY_WINDOW 32      // changes the statistics remember
+#define ANOMALY_MIN_STEPS 8    // learned before the CUSUM runs
+#define ANOMALY_STUCK_READS 30
+#define ANOMALY_STUCK_MS (60UL * 60 * 1000)
+#define ANOMALY_READS 16       // failure window, one bit each in a uint16_t
+#define ANOMALY_MAX_FAILED 8
+#define ANOMALY_CUSUM_K 2.0f   // allowance per change, in variances (a normal one adds about 1)
+#define ANOMALY_CUSUM_CAP 9.0f // one wild change cannot decide alone
+#define ANOMALY_CUSUM_H 40.0f
+#define ANOMALY_CLEAR_READS 10
+
+enum sensor_fault_t : uint8_t
+{
+  SENSOR_FAULT_NONE,
+  SENSOR_FAULT_ERRATIC,
+  SENSOR_FAULT_JUMP,
+  SENSOR_FAULT_STUCK,
+  SENSOR_FAULT_FAILING // highest priority: it says the least about the air
+};
+
+struct anomaly_channel_t
+{
+  float last;                   // last good reading
+  float step;                   // from the reading before
+  float change_mean, change_m2; // Welford over the step-to-step changes
+  float cusum;
+};
+
+struct sensor_anomaly_stats_t
+{
+  uint32_t jumps;
+  uint32_t shifts; // CUSUM alarms
+  uint32_t faults; // raised, of any kind
+};
+
+struct sensor_anomaly_t
+{
+  anomaly_channel_t temp, hum;
+  uint8_t steps; // learned, up to ANOMALY_WINDOW
+  bool have_last;
+  unsigned long last_ms;
+  uint16_t same; // reads equal to the last good one
+  unsigned long same_since_ms;
+  uint16_t failures; // last ANOMALY_READS reads, newest in bit 0, set if failed
+  uint8_t fault;     // sensor_fault_t
+  uint8_t clean;     // good reads in a row that passed every test
+  sensor_anomaly_stats_t stats;
+};
+
+void sensor_anomaly_init(sensor_anomaly_t &a);
+// Feeds one read (NaN if failed); true if the fault changed
+bool sensor_anomaly_update(sensor_anomaly_t &a, float temp, float hum, unsigned long now_ms);
+const char *sensor_fault_name(uint8_t fault);
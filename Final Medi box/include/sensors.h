@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "climate_sampler.h"
+#include "sensor_anomaly.h"
+
+// Climate sensor registry.
+//
+// Each compartment has its own sensor, limits, adaptive sampler and
+// reading history. The drivers share one interface: start a measurement,
+// wait out its conversion time, then fetch the result. sensors_poll() runs
+// those phases from the main loop without blocking, and I2C phases ask
+// i2c_bus.h for bus time so they interleave with the OLED flushes on the
+// same bus. sensors_begin() starts the sensors on one bus (nullptr: the
+// DHT22), so each bus can be brought up on its own at boot; I2C sensors
+// that do not answer are marked absent and skipped. Only one DHT22 is
+// supported (it owns RMT channel 0). Every completed read, failed or not,
+// goes through the sensor's fault detector (sensor_anomaly.h) and is then
+// published as an EVENT_SAMPLE.
+
+#define SENSOR_MAX 4
+#define SENSOR_HISTORY 32
+#define SENSOR_NO_VALUE INT16_MIN // history entry of a failed read
+
+enum sensor_kind_t : uint8_t
+{
+  SENSOR_DHT22,
+  SENSOR_SHT3X,
+  SENSOR_BME280
+};
+
+struct sensor_sample_t
+{
+  uint32_t t_ms;
+  int16_t temp_x10;
+  int16_t hum_x10;
+};
+
+// BME280 trimming parameters for temperature and humidity
+struct bme280_calib_t
+{
+  uint16_t t1;
+  int16_t t2, t3;
+  uint8_t h1, h3;
+  int16_t h2, h4, h5;
+  int8_t h6;
+};
+
+struct sensor_t
+{
+  const char *name; // compartment
+  uint8_t kind;
+  bool present;
+  uint8_t pin;  // DHT22
+  TwoWire *wire; // I2C sensors
+  uint8_t addr;
+  climate_sampler_t sampler; // own limits, interval and stats
+  sensor_anomaly_t anomaly;
+  float temp, hum;           // latest reading, NaN after a failed read
+  unsigned long read_ms;
+
+  uint8_t phase;
+  unsigned long phase_due_ms;
+  sensor_sample_t history[SENSOR_HISTORY];
+  uint8_t history_head, history_count;
+  bme280_calib_t calib;
+};
+
+int sensor_add_dht22(const char *name, uint8_t pin, const climate_limits_t &limits);
+int sensor_add_sht3x(const char *name, TwoWire *wire, uint8_t addr, const climate_limits_t &limits);
+int sensor_add_bme280(const char *name, TwoWire *wire, uint8_t addr, const climate_limits_t &limits);
+void sensors_begin(TwoWire *wire);
+void sensors_poll();
+int sensor_count();
+const sensor_t &sensor(int idx);
+bool sensor_in_range(const sensor_t &s);
+bool sensor_faulty(const sensor_t &s);
+void sensors_export_history(Print &out);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "telemetry_frame.h"
+
+// Binary serial telemetry.
+//
+// Sensor samples, alarm firings, dose outcomes, configuration changes and
+// clock steps are taken from the event bus and sent as framed records
+// (telemetry_frame.h), with a metrics record every TELEMETRY_METRICS_MS
+// followed by the climate exposure totals and the last reset and crash.
+// Data frames never wait for the UART: one that does not fit in the TX
+// buffer is dropped and counted. Console text goes through `console`,
+// which sends each line as a TLM_TEXT frame and does wait, so command
+// output is never lost. Log messages (log.h) are TLM_LOG frames, sent
+// only when the buffer has room. tools/telemetry decodes the stream on
+// the host.
+
+#define TELEMETRY_BAUD 921600
+#define TELEMETRY_TX_BUFFER 2048
+#define TELEMETRY_METRICS_MS 10000
+
+struct telemetry_stats_t
+{
+  uint32_t frames;
+  uint32_t dropped;
+  uint32_t bytes;
+};
+
+extern Print &console;
+
+void telemetry_begin();
+void telemetry_update();
+bool telemetry_log(uint8_t level, const char *text, size_t n); // false if the UART is full, nothing sent
+const telemetry_stats_t &telemetry_stats();
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format of the binary serial telemetry, shared by the firmware and
+// the host decoder in tools/telemetry.
+//
+// A frame is a record COBS-encoded and terminated by a zero byte, so a
+// reader that starts mid-stream or hits a corrupted frame resynchronises
+// at the next zero. The record is little-endian:
+//
+//   type u8 | seq u16 | t_ms u32 | body | crc u16
+//
+// seq counts every frame the firmware produced, including those it had
+// to drop for lack of UART buffer, so a gap is a lost frame. The CRC is
+// CRC-16/CCITT-FALSE over everything before it.
+
+#define TLM_HEADER_BYTES 7
+#define TLM_CRC_BYTES 2
+#define TLM_MAX_BODY 96
+#define TLM_MAX_RECORD (TLM_HEADER_BYTES + TLM_MAX_BODY + TLM_CRC_BYTES)
+#define TLM_MAX_FRAME (TLM_MAX_RECORD + TLM_MAX_RECORD / 254 + 2) // COBS overhead and delimiter
+
+enum tlm_type_t : uint8_t
+{
+  TLM_TEXT = 1,    // console output, one line without the newline
+  TLM_SAMPLE = 2,  // sensor u8, temp_x100 i16, hum_x100 i16 (TLM_NO_VALUE if failed)
+  TLM_ALARM = 3,   // alarm u8, due i32 (local seconds): an alarm started ringing
+  TLM_DOSE = 4,    // alarm u8, action u8 (dose_action_t), due i32, latency_s i32
+  TLM_CONFIG = 5,  // key u8 (config_key_t), value i32, value i32
+  TLM_CLOCK = 6,   // epoch u32 after a clock step
+  TLM_METRICS = 7, // see tlm_metrics_t
+  TLM_LOG = 8,     // level u8 (LOG_LEVEL_*), text
+  TLM_EXPOSURE = 9, // see tlm_exposure_t, one per sensor and period after each TLM_METRICS
+  TLM_CRASH = 10,   // see tlm_crash_t, after each TLM_METRICS
+};
+
+#define TLM_NO_VALUE INT16_MIN
+
+struct tlm_metrics_t
+{
+  uint32_t uptime_s;
+  uint32_t free_heap;
+  uint32_t largest_block;
+  uint32_t max_loop_gap_ms;
+  uint32_t events_dropped;
+  uint32_t bus_deferred;
+  int32_t clock_offset_us;
+  int16_t drift_ppm_x100;
+  uint32_t frames_dropped; // by the firmware, also visible as seq gaps
+};
+#define TLM_METRICS_BYTES 34
+
+// Climate exposure totals (climate_exposure.h), rounded
+struct tlm_exposure_t
+{
+  uint8_t sensor;
+  uint8_t period;  // exposure_period_t
+  uint32_t seconds; // covered by readings
+  int16_t mkt_x100; // TLM_NO_VALUE without readings
+  uint32_t temp_above_x10, temp_below_x10; // °C·min
+  uint32_t hum_above_x10, hum_below_x10;   // %RH·min
+  int16_t hum_mean_x100;
+};
+#define TLM_EXPOSURE_BYTES 26
+
+// Why the device last reset and the previous boot's crash record, if it
+// left one (crash.h)
+#define TLM_CRASH_BACKTRACE 4 // innermost PCs sent
+struct tlm_crash_t
+{
+  uint8_t reset_reason;    // esp_reset_reason_t
+  uint8_t cause;           // crash_cause_t, 0 without a record
+  uint8_t backtrace_depth; // of the whole recorded backtrace
+  uint32_t uptime_ms;      // when it crashed
+  uint32_t exc_cause, exc_vaddr;
+  uint32_t backtrace[TLM_CRASH_BACKTRACE];
+};
+#define TLM_CRASH_BYTES 31
+
+uint16_t tlm_crc16(const uint8_t *data, size_t n);
+size_t tlm_cobs_encode(const uint8_t *in, size_t n, uint8_t *out); // out: n + n / 254 + 1 bytes, no delimiter
+size_t tlm_cobs_decode(const uint8_t *in, size_t n, uint8_t *out); // 0 if malformed
+
+// Little-endian field access over a record buffer
+void tlm_put_u16(uint8_t *p, uint16_t v);
+void tlm_put_u32(uint8_t *p, uint32_t v);
+void tlm_put_u64(uint8_t *p, uint64_t v);
+uint16_t tlm_get_u16(const uint8_t *p);
+uint32_t tlm_get_u32(const uint8_t *p);
+uint64_t tlm_get_u64(const uint8_t *p);
+
+void tlm_pack_metrics(const tlm_metrics_t &m, uint8_t *body);
+void tlm_unpack_metrics(const uint8_t *body, tlm_metrics_t &m);
+void tlm_pack_exposure(const tlm_exposure_t &x, uint8_t *body);
+void tlm_unpack_exposure(const uint8_t *body, tlm_exposure_t &x);
+void tlm_pack_crash(const tlm_crash_t &c, uint8_t *body);
+void tlm_unpack_crash(const uint8_t *body, tlm_crash_t &c);
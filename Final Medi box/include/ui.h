@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Adafruit_SSD1306.h>
+
+// Retained-mode screens for the two OLEDs.
+//
+// A screen is a layer of text widgets on one panel. Setting a widget's
+// text invalidates only the characters that changed; ui_update() redraws
+// those glyph cells into the panel buffer and sends just the touched
+// column ranges of the touched pages, at most once per
+// ui_frame_interval_ms. Layers are stacked in creation order: a framed or
+// inverted layer is opaque, so it hides what lies under its box, and
+// hiding it repaints only that box from the layers below. Imperative
+// screens (menus, print_line) call ui_invalidate() so the next frame
+// repaints the panel in full. Big labels use the flash font in
+// big_font.h instead of scaled GFX text and must sit on a page boundary.
+
+#define UI_MAX_LAYERS 6
+#define UI_MAX_WIDGETS 24
+#define UI_TEXT_MAX 21 // one row of size-1 text
+
+enum ui_style_t : uint8_t
+{
+  UI_PLAIN,   // transparent, for base screens
+  UI_FRAMED,  // black box with a border
+  UI_INVERTED // white box, black text
+};
+
+extern unsigned long ui_frame_interval_ms;
+
+int ui_layer(Adafruit_SSD1306 &disp, int16_t x, int16_t y, int16_t w, int16_t h, ui_style_t style, bool visible);
+int ui_label(int layer, int16_t x, int16_t y, uint8_t size, uint8_t width, const char *text);
+int ui_big_label(int layer, int16_t x, int16_t y, uint8_t scale, uint8_t width, const char *text);
+int ui_value(int layer, int16_t x, int16_t y, uint8_t size, uint8_t width, uint8_t decimals, const char *unit);
+
+void ui_set_text(int widget, const char *text);
+void ui_set_value(int widget, float value); // NaN shows "--"
+void ui_show(int layer, bool visible);
+void ui_invalidate(Adafruit_SSD1306 &disp);
+
+void ui_update();  // render if a frame is due, flush within the bus slice
+void ui_refresh(); // render and flush everything now
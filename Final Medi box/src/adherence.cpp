@@ -0,0 +1,99 @@
+#include "adherence.h"
+
+#include <Preferences.h>
+#include "events.h"
+
+static adherence_record_t ring[ADHERENCE_CAPACITY];
+static uint16_t ring_head = 0; // next slot to write
+static uint16_t ring_count = 0;
+static adherence_counters_t counters = {0, 0, 0};
+
+static uint16_t unflushed = 0;
+static unsigned long last_flush = 0;
+
+static Preferences prefs;
+
+// The ring, its position and the counters are stored as three blobs in the
+// "adherence" NVS namespace and rewritten together on every flush.
+void adherence_begin()
+{
+  prefs.begin("adherence", false);
+  uint16_t pos[2];
+  if (prefs.getBytes("pos", pos, sizeof(pos)) == sizeof(pos) && pos[0] < ADHERENCE_CAPACITY && pos[1] <= ADHERENCE_CAPACITY &&
+      prefs.getBytes("ring", ring, sizeof(ring)) == sizeof(ring))
+  {
+    ring_head = pos[0];
+    ring_count = pos[1];
+  }
+  prefs.getBytes("counters", &counters, sizeof(counters));
+  last_flush = millis();
+}
+
+void adherence_record(uint8_t schedule_id, int64_t due, dose_action_t action, int64_t latency_s)
+{
+  if (latency_s < 0)
+    latency_s = 0;
+  ring[ring_head] = {(uint32_t)due, schedule_id, (uint8_t)action, (uint16_t)min(latency_s, (int64_t)UINT16_MAX)};
+  ring_head = (ring_head + 1) % ADHERENCE_CAPACITY;
+  if (ring_count < ADHERENCE_CAPACITY)
+    ring_count++;
+
+  if (action == DOSE_TAKEN)
+    counters.taken++;
+  else if (action == DOSE_SNOOZED)
+    counters.snoozed++;
+  else
+    counters.missed++;
+
+  unflushed++;
+  adherence_flush(false);
+  event_publish(PRODUCER_LOOP, EVENT_DOSE, schedule_id, (int32_t)due, (int32_t)latency_s, action);
+}
+
+// Batch writes to limit flash wear: flush after ADHERENCE_FLUSH_BATCH new
+// records or ADHERENCE_FLUSH_INTERVAL_MS, whichever comes first.
+void adherence_flush(bool force)
+{
+  if (unflushed == 0)
+    return;
+  if (!force && unflushed < ADHERENCE_FLUSH_BATCH && millis() - last_flush < ADHERENCE_FLUSH_INTERVAL_MS)
+    return;
+  uint16_t pos[2] = {ring_head, ring_count};
+  prefs.putBytes("ring", ring, sizeof(ring));
+  prefs.putBytes("pos", pos, sizeof(pos));
+  prefs.putBytes("counters", &counters, sizeof(counters));
+  unflushed = 0;
+  last_flush = millis();
+}
+
+const adherence_counters_t &adherence_counters()
+{
+  return counters;
+}
+
+// Share of doses taken out of those resolved; snoozes are not outcomes
+float adherence_rate()
+{
+  uint32_t resolved = counters.taken + counters.missed;
+  return resolved == 0 ? 1.0f : (float)counters.taken / resolved;
+}
+
+void adherence_export(Print &out)
+{
+  static const char *action_names[] = {"taken", "snoozed", "missed"};
+  char line[96];
+  snprintf(line, sizeof(line), "# adherence taken=%lu snoozed=%lu missed=%lu rate=%.3f",
+           (unsigned long)counters.taken, (unsigned long)counters.snoozed, (unsigned long)counters.missed,
+           adherence_rate());
+  out.println(line);
+  out.println("due,schedule,action,latency_s");
+  uint16_t start = (ring_head + ADHERENCE_CAPACITY - ring_count) % ADHERENCE_CAPACITY;
+  for (int i = 0; i < ring_count; i++)
+  {
+    const adherence_record_t &rec = ring[(start + i) % ADHERENCE_CAPACITY];
+    snprintf(line, sizeof(line), "%lu,%u,%s,%u", (unsigned long)rec.due, rec.schedule_id,
+             action_names[rec.action % 3], rec.latency_s);
+    out.println(line);
+  }
+  out.println("# end");
+}
@@ -0,0 +1,226 @@
+#include "alarm_scheduler.h"
+
+#include <esp_timer.h>
+#include <sys/time.h>
+#include "adherence.h"
+#include "events.h"
+#include "perf_trace.h"
+
+#define CLOCK_VALID_AFTER 1577836800 // 2020-01-01: anything earlier means the clock has not synced yet
+
+extern long utc_offset;
+
+alarm_time_t alarm_time[n_alarm] = {
+    {true, schedule_daily(0, 0), SCHEDULE_NEVER, 0, SCHEDULE_NEVER, 0, 0}, // Alarm 1
+#if MEDIBOX_WITH_MULTI_ALARM
+    {false, schedule_daily(0, 0), SCHEDULE_NEVER, 0, SCHEDULE_NEVER, 0, 1} // Alarm 2
+#endif
+};
+
+int snooze_minutes = 5;
+int snooze_limit = 3;
+
+static esp_timer_handle_t alarm_timer = nullptr;
+static volatile bool timer_expired = true; // evaluate once the clock is first valid
+static bool clock_adjusted = false;
+static bool needs_reschedule = true;
+static int events = -1;
+static uint32_t events_dropped = 0;
+static alarm_latency_t latency = {0, 0, 0, 0, 0};
+
+static void on_alarm_timer(void *)
+{
+  perf_instant("alarm timer");
+  timer_expired = true;
+}
+
+int64_t local_time_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < CLOCK_VALID_AFTER)
+    return -1;
+  return ((int64_t)tv.tv_sec + utc_offset) * 1000000 + tv.tv_usec;
+}
+
+void alarm_scheduler_begin()
+{
+  esp_timer_create_args_t args = {};
+  args.callback = on_alarm_timer;
+  args.name = "alarm";
+  esp_timer_create(&args, &alarm_timer);
+  events = event_subscribe("alarms", EVENT_MASK(EVENT_CONFIG) | EVENT_MASK(EVENT_CLOCK));
+}
+
+// Schedule edits and time zone changes (EVENT_CONFIG) and clock steps
+// (EVENT_CLOCK) arrive on the event bus. A lost event could be
+// either, so a drop forces a full reschedule.
+bool alarm_scheduler_pending()
+{
+  event_t e;
+  while (event_poll(events, &e))
+  {
+    if (e.type == EVENT_CLOCK)
+      clock_adjusted = true;
+    else if (e.arg == CONFIG_TIME_ZONE || e.arg == CONFIG_ALARM)
+      needs_reschedule = true;
+  }
+  uint32_t dropped = 0;
+  for (int p = 0; p < EVENT_PRODUCERS; p++)
+    dropped += event_stats(events, (event_producer_t)p).dropped;
+  if (dropped != events_dropped)
+  {
+    events_dropped = dropped;
+    needs_reschedule = true;
+  }
+  if (needs_reschedule || clock_adjusted)
+    timer_expired = true;
+  return timer_expired;
+}
+
+// First dose of an alarm's schedule from now that has not been rung yet
+static int64_t first_unrung(const alarm_time_t &a, int64_t now)
+{
+  return schedule_next_due(a.schedule, max(now, a.last_due + 1));
+}
+
+// Hands out due alarms one at a time; call until it returns false, then
+// alarm_scheduler_rearm(). *due is the deadline that fired, for latency;
+// the dose itself is last_due, which stays put across snoozes.
+bool alarm_scheduler_next(int *alarm_idx, int64_t *due)
+{
+  int64_t now_us = local_time_us();
+  if (now_us < 0)
+    return false;
+  int64_t now = now_us / 1000000;
+  timer_expired = false;
+
+  if (needs_reschedule || clock_adjusted)
+  {
+    for (int i = 0; i < n_alarm; i++)
+    {
+      alarm_time_t &a = alarm_time[i];
+      if (!a.alarm_state)
+        a.next_due = SCHEDULE_NEVER;
+      else if (needs_reschedule)
+        a.next_due = first_unrung(a, now);
+      else
+        a.next_due = min(a.next_due, first_unrung(a, now)); // a backward step must not delay a dose
+    }
+    needs_reschedule = false;
+    clock_adjusted = false;
+  }
+
+  for (int i = 0; i < n_alarm; i++)
+  {
+    alarm_time_t &a = alarm_time[i];
+    if (!a.alarm_state)
+      continue;
+    if (a.snooze_due <= now && a.snooze_due < a.next_due)
+    {
+      *alarm_idx = i;
+      *due = a.snooze_due;
+      a.snooze_due = SCHEDULE_NEVER;
+      return true;
+    }
+    if (a.next_due > now)
+      continue;
+    if (a.snooze_due != SCHEDULE_NEVER)
+    {
+      // The next dose came round before the snoozed one was acknowledged
+      adherence_record(i, a.last_due, DOSE_MISSED, now - a.last_due);
+      a.snooze_due = SCHEDULE_NEVER;
+    }
+    // Catch up: only the latest elapsed dose rings, older ones were missed
+    int64_t d = a.next_due;
+    int64_t following = schedule_next_due(a.schedule, d + 1);
+    while (following <= now)
+    {
+      adherence_record(i, d, DOSE_MISSED, now - d);
+      d = following;
+      following = schedule_next_due(a.schedule, d + 1);
+    }
+    a.next_due = following;
+    a.last_due = d;
+    a.snooze_count = 0;
+    *alarm_idx = i;
+    *due = d;
+    return true;
+  }
+  return false;
+}
+
+void alarm_scheduler_rearm()
+{
+  int64_t now_us = local_time_us();
+  if (now_us < 0 || alarm_timer == nullptr)
+    return;
+  esp_timer_stop(alarm_timer);
+  int which;
+  int64_t due = alarm_scheduler_next_dose(&which);
+  for (int i = 0; i < n_alarm; i++)
+    if (alarm_time[i].alarm_state)
+      due = min(due, alarm_time[i].snooze_due);
+  if (due == SCHEDULE_NEVER)
+    return;
+  int64_t delay_us = due * 1000000 - now_us;
+  if (delay_us <= 0)
+    timer_expired = true;
+  else
+    esp_timer_start_once(alarm_timer, delay_us);
+}
+
+// Re-ring the current dose of an alarm in snooze_minutes. Returns false
+// once the dose has used up snooze_limit snoozes.
+bool alarm_scheduler_snooze(int alarm_idx)
+{
+  alarm_time_t &a = alarm_time[alarm_idx];
+  int64_t now_us = local_time_us();
+  if (now_us < 0 || a.snooze_count >= snooze_limit)
+    return false;
+  a.snooze_count++;
+  a.snooze_due = now_us / 1000000 + snooze_minutes * 60;
+  timer_expired = true; // rearm on the next service pass
+  return true;
+}
+
+void alarm_scheduler_cancel_snooze(int alarm_idx)
+{
+  alarm_time[alarm_idx].snooze_due = SCHEDULE_NEVER;
+  alarm_time[alarm_idx].snooze_count = 0;
+}
+
+void alarm_scheduler_record_latency(int64_t due)
+{
+  int64_t now_us = local_time_us();
+  if (now_us < 0)
+    return;
+  int32_t ms = (int32_t)((now_us - due * 1000000) / 1000);
+  latency.fired++;
+  if (ms > 1000)
+    latency.late++;
+  latency.last_ms = ms;
+  latency.max_ms = max(latency.max_ms, ms);
+  latency.total_ms += ms;
+}
+
+// Next dose across all alarms; constant time since next_due is cached
+int64_t alarm_scheduler_next_dose(int *which)
+{
+  int64_t best = SCHEDULE_NEVER;
+  *which = -1;
+  for (int i = 0; i < n_alarm; i++)
+  {
+    if (alarm_time[i].alarm_state && alarm_time[i].next_due < best)
+    {
+      best = alarm_time[i].next_due;
+      *which = i;
+    }
+  }
+  return best;
+}
+
+const alarm_latency_t &alarm_latency()
+{
+  return latency;
+}
@@ -0,0 +1,165 @@
+#include "big_font.h"
+
+#define SRC_W 5
+#define SRC_H 8
+
+static constexpr char glyph_chars[] = "0123456789: -ADFJMNOSabceglnoprtuvy";
+constexpr int n_glyphs = sizeof(glyph_chars) - 1;
+
+// 5x8 source glyphs, one byte per column, bit 0 = top row, row 7 for descenders
+static constexpr uint8_t source[n_glyphs][SRC_W] = {
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // 2
+    {0x21, 0x41, 0x45, 0x4B, 0x31}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1E}, // 9
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // :
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, // A
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, // D
+    {0x7F, 0x09, 0x09, 0x09, 0x01}, // F
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, // J
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F}, // M
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // N
+    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // O
+    {0x46, 0x49, 0x49, 0x49, 0x31}, // S
+    {0x20, 0x54, 0x54, 0x54, 0x78}, // a
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, // b
+    {0x38, 0x44, 0x44, 0x44, 0x20}, // c
+    {0x38, 0x54, 0x54, 0x54, 0x18}, // e
+    {0x18, 0xA4, 0xA4, 0xA4, 0x7C}, // g
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, // l
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, // n
+    {0x38, 0x44, 0x44, 0x44, 0x38}, // o
+    {0xFC, 0x24, 0x24, 0x24, 0x18}, // p
+    {0x7C, 0x08, 0x04, 0x04, 0x08}, // r
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, // t
+    {0x3C, 0x40, 0x40, 0x20, 0x7C}, // u
+    {0x1C, 0x20, 0x40, 0x20, 0x1C}, // v
+    {0x1C, 0xA0, 0xA0, 0xA0, 0x7C}, // y
+};
+
+// S pages of SRC_W * S columns per glyph, as the SSD1306 stores them
+template <int S>
+struct scaled_font_t
+{
+  uint8_t page[n_glyphs][S][SRC_W * S];
+};
+
+constexpr bool src_px(int g, int x, int y)
+{
+  return x >= 0 && x < SRC_W && y >= 0 && y < SRC_H && ((source[g][x] >> y) & 1);
+}
+
+// Pixel (px, py) of glyph g upscaled S times. Scale2x/Scale3x fill the
+// inside corners of diagonal steps, so strokes come out rounded instead
+// of as staircases of S x S blocks.
+template <int S>
+constexpr bool scaled_px(int g, int px, int py)
+{
+  int x = px / S, y = py / S, i = px % S, j = py % S;
+  bool a = src_px(g, x - 1, y - 1), b = src_px(g, x, y - 1), c = src_px(g, x + 1, y - 1);
+  bool d = src_px(g, x - 1, y), e = src_px(g, x, y), f = src_px(g, x + 1, y);
+  bool gg = src_px(g, x - 1, y + 1), h = src_px(g, x, y + 1), k = src_px(g, x + 1, y + 1);
+  bool top_left = d == b && b != f && d != h;
+  bool top_right = b == f && b != d && f != h;
+  bool bottom_left = d == h && d != b && h != f;
+  bool bottom_right = h == f && h != d && f != b;
+  if constexpr (S == 2)
+  {
+    if (j == 0)
+      return i == 0 ? (top_left ? d : e) : (top_right ? f : e);
+    return i == 0 ? (bottom_left ? d : e) : (bottom_right ? f : e);
+  }
+  else
+  {
+    switch (j * 3 + i)
+    {
+    case 0:
+      return top_left ? d : e;
+    case 1:
+      return (top_left && e != c) || (top_right && e != a) ? b : e;
+    case 2:
+      return top_right ? f : e;
+    case 3:
+      return (top_left && e != gg) || (bottom_left && e != a) ? d : e;
+    case 5:
+      return (top_right && e != k) || (bottom_right && e != c) ? f : e;
+    case 6:
+      return bottom_left ? d : e;
+    case 7:
+      return (bottom_left && e != k) || (bottom_right && e != gg) ? h : e;
+    case 8:
+      return bottom_right ? f : e;
+    default:
+      return e;
+    }
+  }
+}
+
+template <int S>
+constexpr scaled_font_t<S> make_font()
+{
+  scaled_font_t<S> font = {};
+  for (int g = 0; g < n_glyphs; g++)
+    for (int p = 0; p < S; p++)
+      for (int x = 0; x < SRC_W * S; x++)
+      {
+        uint8_t column = 0;
+        for (int bit = 0; bit < 8; bit++)
+          if (scaled_px<S>(g, x, p * 8 + bit))
+            column |= 1 << bit;
+        font.page[g][p][x] = column;
+      }
+  return font;
+}
+
+static constexpr scaled_font_t<2> font_2x = make_font<2>();
+static constexpr scaled_font_t<3> font_3x = make_font<3>();
+
+static int glyph_index(char c)
+{
+  const char *p = strchr(glyph_chars, c);
+  return c != '\0' && p != nullptr ? p - glyph_chars : -1;
+}
+
+bool big_font_has(char c)
+{
+  return glyph_index(c) >= 0;
+}
+
+#ifndef MEDIBOX_HOST
+
+void big_font_draw(Adafruit_SSD1306 &disp, int16_t x, int16_t y, uint8_t scale, char c, bool invert)
+{
+  int g = glyph_index(c);
+  if (g < 0 || scale < BIG_FONT_MIN_SCALE || scale > BIG_FONT_MAX_SCALE)
+    return;
+  const uint8_t *rows = scale == 2 ? &font_2x.page[g][0][0] : &font_3x.page[g][0][0];
+  int w = SRC_W * scale;
+  int x0 = max(0, -x), x1 = min(w, disp.width() - x); // clip to the panel
+  if (x0 >= x1)
+    return;
+  uint8_t *buffer = disp.getBuffer();
+  for (int p = 0; p < scale; p++)
+  {
+    int page = y / 8 + p;
+    if (page < 0 || page >= disp.height() / 8)
+      continue;
+    uint8_t *dst = buffer + page * disp.width() + x;
+    const uint8_t *src = rows + p * w;
+    if (!invert)
+      memcpy(dst + x0, src + x0, x1 - x0);
+    else
+      for (int i = x0; i < x1; i++)
+        dst[i] = ~src[i];
+  }
+}
+
+#endif
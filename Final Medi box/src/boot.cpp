@@ -0,0 +1,193 @@
+#include "boot.h"
+
+#include <esp_timer.h>
+#include "log.h"
+
+#ifndef MEDIBOX_HOST
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#define JOB_INLINE_OK -2 // no stage left: the job ran inline and succeeded
+
+struct boot_job_state_t
+{
+  boot_job_t fn;
+  void *arg;
+  volatile bool done;
+#ifndef MEDIBOX_HOST
+  SemaphoreHandle_t finished;
+#endif
+};
+
+static boot_stage_t stages[BOOT_MAX_STAGES];
+static boot_job_state_t jobs[BOOT_MAX_STAGES]; // by stage
+static int n_stages = 0;
+static int current = -1; // running sequential stage
+static uint32_t first_frame_us = 0;
+static uint32_t setup_us = 0;
+
+static uint32_t now_us()
+{
+  return (uint32_t)esp_timer_get_time();
+}
+
+static int add_stage(const char *name, bool parallel)
+{
+  if (n_stages == BOOT_MAX_STAGES)
+  {
+    LOG_W("boot: no room for stage %s", name);
+    return -1;
+  }
+  stages[n_stages] = {name, now_us(), 0, parallel, true, false};
+  return n_stages++;
+}
+
+static void close_stage()
+{
+  if (current >= 0)
+    stages[current].us = now_us() - stages[current].start_us;
+  current = -1;
+}
+
+// The time before setup() is the core's start-up
+void boot_begin()
+{
+  int idx = add_stage("startup", false);
+  stages[idx].start_us = 0;
+  stages[idx].us = now_us();
+}
+
+void boot_stage(const char *name)
+{
+  close_stage();
+  current = add_stage(name, false);
+}
+
+static void run_job(int idx)
+{
+  boot_stage_t &s = stages[idx];
+  s.start_us = now_us();
+  s.ok = jobs[idx].fn(jobs[idx].arg);
+  s.us = now_us() - s.start_us;
+  jobs[idx].done = true;
+}
+
+#ifdef MEDIBOX_HOST
+
+int boot_spawn(const char *name, boot_job_t job, void *arg)
+{
+  int idx = add_stage(name, true);
+  if (idx < 0)
+    return job(arg) ? JOB_INLINE_OK : -1;
+  jobs[idx] = {job, arg, false};
+  run_job(idx);
+  return idx;
+}
+
+bool boot_join(int job, uint32_t timeout_ms)
+{
+  if (job < 0)
+    return job == JOB_INLINE_OK;
+  return stages[job].ok;
+}
+
+#else
+
+static void job_task(void *arg)
+{
+  int idx = (int)(intptr_t)arg;
+  run_job(idx);
+  xSemaphoreGive(jobs[idx].finished);
+  vTaskDelete(nullptr);
+}
+
+// Core 0 runs WiFi and little else during setup(); the loop task is on
+// core 1. A job that cannot get a task runs inline.
+int boot_spawn(const char *name, boot_job_t job, void *arg)
+{
+  int idx = add_stage(name, true);
+  if (idx < 0)
+    return job(arg) ? JOB_INLINE_OK : -1;
+  jobs[idx] = {job, arg, false, xSemaphoreCreateBinary()};
+  if (jobs[idx].finished == nullptr ||
+      xTaskCreatePinnedToCore(job_task, name, BOOT_JOB_STACK, (void *)(intptr_t)idx, 1, nullptr, 0) != pdPASS)
+  {
+    stages[idx].parallel = false;
+    run_job(idx);
+    if (jobs[idx].finished != nullptr)
+      xSemaphoreGive(jobs[idx].finished);
+  }
+  return idx;
+}
+
+bool boot_join(int job, uint32_t timeout_ms)
+{
+  if (job < 0)
+    return job == JOB_INLINE_OK;
+  boot_job_state_t &j = jobs[job];
+  if (j.finished == nullptr)
+    return stages[job].ok;
+  if (xSemaphoreTake(j.finished, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+  {
+    stages[job].timed_out = true;
+    LOG_E("boot: %s timed out after %lums", stages[job].name, (unsigned long)timeout_ms);
+    return false; // the semaphore stays with the job
+  }
+  vSemaphoreDelete(j.finished);
+  j.finished = nullptr;
+  return stages[job].ok;
+}
+
+#endif
+
+void boot_first_frame()
+{
+  if (first_frame_us == 0)
+    first_frame_us = now_us();
+}
+
+void boot_end()
+{
+  close_stage();
+  setup_us = now_us();
+  unsigned long frame_ms = first_frame_us / 1000;
+  if (frame_ms > BOOT_FIRST_FRAME_TARGET_MS)
+    LOG_W("boot: first frame at %lums, target %dms", frame_ms, BOOT_FIRST_FRAME_TARGET_MS);
+  LOG_I("boot: first frame %lums, setup %lums", frame_ms, (unsigned long)(setup_us / 1000));
+}
+
+int boot_stage_count()
+{
+  return n_stages;
+}
+
+const boot_stage_t &boot_stage_info(int idx)
+{
+  return stages[idx];
+}
+
+uint32_t boot_first_frame_us()
+{
+  return first_frame_us;
+}
+
+void boot_report(Print &out)
+{
+  out.printf("boot first_frame=%lu.%lums target=%dms setup=%lu.%lums\n", (unsigned long)(first_frame_us / 1000),
+             (unsigned long)(first_frame_us / 100 % 10), BOOT_FIRST_FRAME_TARGET_MS,
+             (unsigned long)(setup_us / 1000), (unsigned long)(setup_us / 100 % 10));
+  for (int i = 0; i < n_stages; i++)
+  {
+    const boot_stage_t &s = stages[i];
+    const char *result = "";
+    if (s.timed_out)
+      result = jobs[i].done ? " late" : " timeout";
+    else if (!s.ok)
+      result = " failed";
+    out.printf("boot %s%s at=%lu.%lums took=%lu.%lums%s\n", s.parallel ? "&" : "", s.name,
+               (unsigned long)(s.start_us / 1000), (unsigned long)(s.start_us / 100 % 10),
+               (unsigned long)(s.us / 1000), (unsigned long)(s.us / 100 % 10), result);
+  }
+}
@@ -0,0 +1,26 @@
+#include "buttons.h"
+
+#include "events.h"
+#include "input_trace.h"
+#include "perf_trace.h"
+#include "pins.h"
+
+static const uint8_t button_pins[] = {PB_Cancel, PB_OK, PB_Up, PB_Down};
+
+static void IRAM_ATTR button_isr(void *arg)
+{
+  uint8_t pin = (uint8_t)(uintptr_t)arg;
+  perf_instant("button isr", pin);
+  uint8_t level = digitalRead(pin);
+  trace_record_button(pin, level);
+  event_publish(PRODUCER_ISR, EVENT_BUTTON, pin, level);
+}
+
+void buttons_begin()
+{
+  for (uint8_t pin : button_pins)
+  {
+    trace_record_button(pin, digitalRead(pin));
+    attachInterruptArg(digitalPinToInterrupt(pin), button_isr, (void *)(uintptr_t)pin, CHANGE);
+  }
+}
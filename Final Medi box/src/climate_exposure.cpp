@@ -0,0 +1,159 @@
+#include "climate_exposure.h"
+
+#include <Preferences.h>
+#include "alarm_scheduler.h"
+#include "sensors.h"
+
+struct channel_t
+{
+  exposure_t periods[EXPOSURE_PERIODS];
+  bool have_last; // the previous reading was good, so the interval counts
+  unsigned long last_ms;
+  float last_temp, last_hum;
+  double last_weight;
+};
+
+static channel_t channels[SENSOR_MAX];
+static bool dirty = false;
+static unsigned long last_flush = 0;
+
+static Preferences prefs;
+
+static const char *period_names[EXPOSURE_PERIODS] = {"day", "week", "lifetime"};
+
+static double arrhenius_weight(float temp)
+{
+  return exp(-EXPOSURE_DELTA_H_R / (temp + 273.15));
+}
+
+static float excess(float value, float limit)
+{
+  return value > limit ? value - limit : 0;
+}
+
+// Day 0, 1 January 1970, was a Thursday
+static uint32_t week_start(uint32_t day)
+{
+  return day - (day + 3) % 7;
+}
+
+void climate_exposure_begin()
+{
+  prefs.begin("exposure", false);
+  for (int i = 0; i < sensor_count(); i++)
+  {
+    exposure_t *p = channels[i].periods;
+    if (prefs.getBytes(sensor(i).name, p, sizeof(channels[i].periods)) != sizeof(channels[i].periods))
+      memset(p, 0, sizeof(channels[i].periods));
+  }
+  last_flush = millis();
+}
+
+// A new day or week starts its period afresh. Returns true when a day
+// ended, so the one just finished is stored at once.
+static bool roll(channel_t &c, uint32_t day)
+{
+  exposure_t *p = c.periods;
+  bool ended = false;
+  if (p[EXPOSURE_DAY].start != day)
+  {
+    ended = p[EXPOSURE_DAY].start != 0;
+    p[EXPOSURE_DAY] = {};
+    p[EXPOSURE_DAY].start = day;
+  }
+  if (p[EXPOSURE_WEEK].start != week_start(day))
+  {
+    p[EXPOSURE_WEEK] = {};
+    p[EXPOSURE_WEEK].start = week_start(day);
+  }
+  if (p[EXPOSURE_LIFETIME].start == 0)
+    p[EXPOSURE_LIFETIME].start = day;
+  return ended;
+}
+
+void climate_exposure_update(int sensor_idx, float temp, float hum, unsigned long t_ms)
+{
+  channel_t &c = channels[sensor_idx];
+  const sensor_t &s = sensor(sensor_idx);
+  if (isnan(temp) || isnan(hum) || sensor_faulty(s))
+  {
+    c.have_last = false;
+    return;
+  }
+
+  int64_t now_us = local_time_us();
+  uint32_t day = now_us < 0 ? 0 : (uint32_t)(now_us / (86400 * 1000000LL));
+  bool day_ended = day != 0 && roll(c, day);
+
+  // Trapezoids: each interval counts with the mean of its two ends
+  double weight = arrhenius_weight(temp);
+  unsigned long dt_ms = t_ms - c.last_ms;
+  if (c.have_last && dt_ms > 0 && dt_ms <= EXPOSURE_MAX_GAP_MS)
+  {
+    const climate_limits_t &l = s.sampler.limits;
+    double dt = dt_ms / 1000.0;
+    double arrhenius = (weight + c.last_weight) / 2 * dt;
+    double temp_above = (excess(temp, l.temp_max) + excess(c.last_temp, l.temp_max)) / 2 * dt / 60;
+    double temp_below = (excess(l.temp_min, temp) + excess(l.temp_min, c.last_temp)) / 2 * dt / 60;
+    double hum_above = (excess(hum, l.hum_max) + excess(c.last_hum, l.hum_max)) / 2 * dt / 60;
+    double hum_below = (excess(l.hum_min, hum) + excess(l.hum_min, c.last_hum)) / 2 * dt / 60;
+    double hum_sum = ((double)hum + c.last_hum) / 2 * dt;
+    for (int p = 0; p < EXPOSURE_PERIODS; p++)
+    {
+      if (p != EXPOSURE_LIFETIME && day == 0)
+        continue;
+      exposure_t &e = c.periods[p];
+      e.seconds += dt;
+      e.arrhenius += arrhenius;
+      e.temp_above += temp_above;
+      e.temp_below += temp_below;
+      e.hum_above += hum_above;
+      e.hum_below += hum_below;
+      e.hum_sum += hum_sum;
+    }
+    dirty = true;
+  }
+  c.have_last = true;
+  c.last_ms = t_ms;
+  c.last_temp = temp;
+  c.last_hum = hum;
+  c.last_weight = weight;
+  climate_exposure_flush(day_ended);
+}
+
+// Batch writes to limit flash wear, as the adherence log does
+void climate_exposure_flush(bool force)
+{
+  if (!dirty)
+    return;
+  if (!force && millis() - last_flush < EXPOSURE_FLUSH_INTERVAL_MS)
+    return;
+  for (int i = 0; i < sensor_count(); i++)
+    if (sensor(i).present)
+      prefs.putBytes(sensor(i).name, channels[i].periods, sizeof(channels[i].periods));
+  dirty = false;
+  last_flush = millis();
+}
+
+const exposure_t &climate_exposure(int sensor_idx, exposure_period_t period)
+{
+  return channels[sensor_idx].periods[period];
+}
+
+// MKT = (ΔH/R) / -ln(mean of exp(-ΔH/RT))
+float exposure_mkt(const exposure_t &e)
+{
+  if (e.seconds <= 0)
+    return NAN;
+  return EXPOSURE_DELTA_H_R / -log(e.arrhenius / e.seconds) - 273.15;
+}
+
+float exposure_hum_mean(const exposure_t &e)
+{
+  return e.seconds > 0 ? e.hum_sum / e.seconds : NAN;
+}
+
+const char *exposure_period_name(exposure_period_t period)
+{
+  return period < EXPOSURE_PERIODS ? period_names[period] : "?";
+}
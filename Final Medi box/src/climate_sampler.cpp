@@ -0,0 +1,92 @@
+#include "climate_sampler.h"
+
+const climate_limits_t climate_default_limits = {24, 32, 65, 80};
+unsigned long climate_max_latency_ms = 60000;
+unsigned long climate_forecast_horizon_s = 30 * 60;
+float climate_forecast_z = 2; // about 98% sure the slope is at least this steep
+
+void climate_sampler_init(climate_sampler_t &s, const climate_limits_t &limits)
+{
+  s = {};
+  s.limits = limits;
+  s.last_in_range = true;
+  s.stats.interval_ms = SAMPLER_MIN_INTERVAL_MS;
+}
+
+bool climate_in_range(const climate_limits_t &limits, float temp, float hum)
+{
+  return !(temp < limits.temp_min || temp > limits.temp_max ||
+           hum < limits.hum_min || hum > limits.hum_max);
+}
+
+bool climate_sampler_due(const climate_sampler_t &s, unsigned long now_ms)
+{
+  return !s.sampled_once || (long)(now_ms - s.next_sample_ms) >= 0;
+}
+
+void climate_sampler_update(climate_sampler_t &s, float temp, float hum, unsigned long now_ms)
+{
+  s.stats.reads++;
+  s.sampled_once = true;
+  unsigned long interval = climate_max_latency_ms;
+
+  if (isnan(temp) || isnan(hum))
+  {
+    s.stats.failed++;
+    if (s.burst_left == 0)
+      s.stats.bursts++;
+    s.burst_left = SAMPLER_BURST_COUNT;
+  }
+  else
+  {
+    climate_trend_update(s.temp_trend, temp, now_ms);
+    climate_trend_update(s.hum_trend, hum, now_ms);
+    bool in_range = climate_in_range(s.limits, temp, hum);
+    if (in_range != s.last_in_range)
+    {
+      s.stats.bursts++;
+      s.burst_left = SAMPLER_BURST_COUNT;
+    }
+    s.last_in_range = in_range;
+
+    if (in_range)
+    {
+      // The best guess, however unsure: sampling more often costs little
+      float t = min(climate_trend_seconds_to(s.temp_trend, s.limits.temp_min, s.limits.temp_max, 0),
+                    climate_trend_seconds_to(s.hum_trend, s.limits.hum_min, s.limits.hum_max, 0));
+      float wanted_ms = t * 1000 / SAMPLER_SAMPLES_BEFORE_CROSSING;
+      if (wanted_ms < interval)
+        interval = (unsigned long)wanted_ms;
+    }
+    else
+      interval = SAMPLER_MIN_INTERVAL_MS; // follow an excursion closely until it recovers
+  }
+
+  if (s.burst_left > 0)
+  {
+    s.burst_left--;
+    interval = SAMPLER_MIN_INTERVAL_MS;
+  }
+  interval = max(interval, (unsigned long)SAMPLER_MIN_INTERVAL_MS);
+  s.stats.interval_ms = interval;
+  s.next_sample_ms = now_ms + interval;
+}
+
+static void earliest(climate_forecast_t *f, uint8_t channel, const climate_trend_t &t, float lo, float hi)
+{
+  if (t.samples < SAMPLER_FORECAST_MIN_SAMPLES)
+    return;
+  float seconds = climate_trend_seconds_to(t, lo, hi, climate_forecast_z);
+  if (seconds < f->seconds)
+    *f = {channel, t.level > hi || (t.level >= lo && t.slope > 0) ? hi : lo, seconds};
+}
+
+bool climate_sampler_forecast(const climate_sampler_t &s, climate_forecast_t *f)
+{
+  if (!s.last_in_range)
+    return false; // the range check has it already
+  *f = {CLIMATE_TEMP, 0, INFINITY};
+  earliest(f, CLIMATE_TEMP, s.temp_trend, s.limits.temp_min, s.limits.temp_max);
+  earliest(f, CLIMATE_HUM, s.hum_trend, s.limits.hum_min, s.limits.hum_max);
+  return f->seconds <= climate_forecast_horizon_s;
+}
@@ -0,0 +1,48 @@
+#include "climate_trend.h"
+
+void climate_trend_update(climate_trend_t &t, float value, unsigned long now_ms)
+{
+  if (t.samples == 0)
+  {
+    t = {};
+    t.level = value;
+    t.last_ms = now_ms;
+    t.samples = 1;
+    return;
+  }
+  if (now_ms == t.last_ms)
+    return;
+  float dt = (now_ms - t.last_ms) / 1000.0f;
+  float a = 1 - expf(-dt / TREND_LEVEL_TAU_S);
+  float b = 1 - expf(-dt / TREND_SLOPE_TAU_S);
+
+  float level = t.level + t.slope * dt;
+  level += a * (value - level);
+  float seen = (level - t.level) / dt - t.slope;
+  t.slope += b * seen;
+  t.slope_var += b * (seen * seen - t.slope_var);
+  t.gain = b;
+  t.level = level;
+  t.last_ms = now_ms;
+  if (t.samples < UINT16_MAX)
+    t.samples++;
+}
+
+// An exponential average with weight b has b / (2 - b) of its input's
+// variance
+float climate_trend_slope_se(const climate_trend_t &t)
+{
+  return sqrtf(t.slope_var * t.gain / (2 - t.gain));
+}
+
+float climate_trend_seconds_to(const climate_trend_t &t, float lo, float hi, float z)
+{
+  if (t.level < lo || t.level > hi)
+    return 0;
+  float margin = z * climate_trend_slope_se(t);
+  if (t.slope > margin)
+    return (hi - t.level) / (t.slope - margin);
+  if (t.slope < -margin)
+    return (t.level - lo) / (-t.slope - margin);
+  return INFINITY;
+}
@@ -0,0 +1,305 @@
+#include "clock_sync.h"
+
+#include "log.h"
+
+const char *clock_servers[] = {"pool.ntp.org", "time.google.com", "time.cloudflare.com"};
+constexpr int n_clock_servers = sizeof(clock_servers) / sizeof(clock_servers[0]);
+
+// The host replay build takes clock adjustments from the trace instead,
+// see tools/host/host_env.cpp
+#ifndef MEDIBOX_HOST
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <lwip/dns.h>
+
+#define NTP_PORT 123
+#define NTP_PACKET_BYTES 48
+#define NTP_UNIX_OFFSET 2208988800UL // 1900 to 1970
+
+enum sync_state_t : uint8_t
+{
+  SYNC_IDLE,
+  SYNC_CONNECTING,
+  SYNC_RESOLVING,
+  SYNC_QUERYING
+};
+
+// Written from the lwIP task when a lookup completes
+struct ntp_server_t
+{
+  volatile uint32_t addr; // IPv4, network order; 0 until first resolved
+  volatile bool pending;
+};
+
+struct ntp_sample_t
+{
+  bool valid;
+  int64_t offset_us; // server minus local
+  int64_t rtt_us;
+};
+
+static const char *wifi_ssid;
+static const char *wifi_password;
+static int wifi_channel;
+static clock_adjust_cb_t adjust_cb = nullptr;
+
+static WiFiUDP udp;
+static ntp_server_t servers[n_clock_servers];
+static sync_state_t state = SYNC_IDLE;
+static unsigned long state_since_ms = 0;
+static unsigned long radio_since_ms = 0;
+static unsigned long next_sync_ms = 0;
+static unsigned long last_drift_ms = 0;
+static int query = 0;
+static ntp_sample_t best;
+static int64_t last_sync_us = 0; // local time of the last applied sync
+static clock_sync_stats_t stats = {false, 0, 0, 0, 0, 0, 0.0f, CLOCK_MIN_INTERVAL_MS, 0};
+
+static int64_t local_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int64_t ntp_to_us(const uint8_t *p)
+{
+  uint32_t sec = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+  uint32_t frac = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+  return ((int64_t)sec - NTP_UNIX_OFFSET) * 1000000 + (((uint64_t)frac * 1000000) >> 32);
+}
+
+static void us_to_ntp(int64_t us, uint8_t *p)
+{
+  uint32_t sec = (uint32_t)(us / 1000000 + NTP_UNIX_OFFSET);
+  uint32_t frac = (uint32_t)(((uint64_t)(us % 1000000) << 32) / 1000000);
+  for (int i = 0; i < 4; i++)
+  {
+    p[i] = sec >> (24 - 8 * i);
+    p[4 + i] = frac >> (24 - 8 * i);
+  }
+}
+
+// One client request; offset and round trip from the four timestamps
+static ntp_sample_t ntp_query(const IPAddress &server)
+{
+  ntp_sample_t s = {false, 0, 0};
+  uint8_t packet[NTP_PACKET_BYTES] = {0};
+  packet[0] = 0x23; // LI 0, version 4, client
+  int64_t t1 = local_us();
+  us_to_ntp(t1, packet + 40); // echoed back as the originate timestamp
+  uint8_t sent[8];
+  memcpy(sent, packet + 40, 8);
+  while (udp.parsePacket() > 0) // stale replies from an earlier timeout
+    udp.flush();
+  if (!udp.beginPacket(server, NTP_PORT))
+    return s;
+  udp.write(packet, NTP_PACKET_BYTES);
+  if (!udp.endPacket())
+    return s;
+
+  unsigned long start = millis();
+  while (udp.parsePacket() < NTP_PACKET_BYTES)
+  {
+    if (millis() - start >= CLOCK_REPLY_TIMEOUT_MS)
+      return s;
+    delay(1);
+  }
+  int64_t t4 = local_us();
+  udp.read(packet, NTP_PACKET_BYTES);
+  uint8_t leap = packet[0] >> 6, mode = packet[0] & 7, stratum = packet[1];
+  if (memcmp(packet + 24, sent, 8) != 0 || mode != 4 || leap == 3 || stratum == 0 || stratum > 15)
+    return s; // not our request, unsynchronised server or kiss-o'-death
+  int64_t t2 = ntp_to_us(packet + 32), t3 = ntp_to_us(packet + 40);
+  s.offset_us = ((t2 - t1) + (t3 - t4)) / 2;
+  s.rtt_us = (t4 - t1) - (t3 - t2);
+  s.valid = s.rtt_us >= 0;
+  return s;
+}
+
+static void dns_found(const char *name, const ip_addr_t *ip, void *arg)
+{
+  ntp_server_t &srv = servers[(intptr_t)arg];
+  if (ip != nullptr && IP_IS_V4(ip))
+    srv.addr = ip4_addr_get_u32(ip_2_ip4(ip));
+  srv.pending = false;
+}
+
+// Starts every lookup without waiting; answers from lwIP's cache come back
+// at once, the rest through dns_found()
+static void resolve_servers()
+{
+  for (int i = 0; i < n_clock_servers; i++)
+  {
+    ntp_server_t &srv = servers[i];
+    ip_addr_t ip;
+    srv.pending = true;
+    err_t err = dns_gethostbyname(clock_servers[i], &ip, dns_found, (void *)(intptr_t)i);
+    if (err == ERR_OK)
+      dns_found(clock_servers[i], &ip, (void *)(intptr_t)i);
+    else if (err != ERR_INPROGRESS)
+      srv.pending = false;
+  }
+}
+
+static void radio_on()
+{
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(wifi_ssid, wifi_password, wifi_channel);
+  radio_since_ms = millis();
+}
+
+static void radio_off()
+{
+  udp.stop();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  stats.radio_on_ms += millis() - radio_since_ms;
+}
+
+// Slew by delta_us on top of whatever adjtime() has not applied yet
+static void slew(int64_t delta_us)
+{
+  struct timeval left;
+  adjtime(nullptr, &left);
+  int64_t total = (int64_t)left.tv_sec * 1000000 + left.tv_usec + delta_us;
+  struct timeval tv = {(time_t)(total / 1000000), (suseconds_t)(total % 1000000)};
+  adjtime(&tv, nullptr);
+}
+
+static void apply(const ntp_sample_t &s)
+{
+  int64_t now = local_us();
+  int64_t offset = s.offset_us;
+  bool step = !stats.synced || offset > CLOCK_STEP_US || offset < -CLOCK_STEP_US;
+  if (step)
+  {
+    struct timeval zero = {0, 0};
+    adjtime(&zero, nullptr); // drop any slew still in progress
+    int64_t t = now + offset;
+    struct timeval tv = {(time_t)(t / 1000000), (suseconds_t)(t % 1000000)};
+    settimeofday(&tv, nullptr);
+    stats.steps++;
+    stats.interval_ms = CLOCK_MIN_INTERVAL_MS;
+    LOG_I("clock stepped %ld ms", (long)(offset / 1000));
+    if (adjust_cb != nullptr)
+      adjust_cb(&tv);
+  }
+  else
+  {
+    slew(offset);
+    // What is left after slewing the estimate in is the estimate's error
+    float elapsed_s = (now - last_sync_us) / 1e6f;
+    if (elapsed_s > 0)
+      stats.drift_ppm = constrain(stats.drift_ppm + 0.5f * offset / elapsed_s, -CLOCK_MAX_DRIFT_PPM, CLOCK_MAX_DRIFT_PPM);
+    int64_t residual = offset < 0 ? -offset : offset;
+    if (residual < CLOCK_GOOD_US)
+      stats.interval_ms = min(stats.interval_ms * 2, CLOCK_MAX_INTERVAL_MS);
+    else if (residual > CLOCK_POOR_US)
+      stats.interval_ms = max(stats.interval_ms / 2, CLOCK_MIN_INTERVAL_MS);
+  }
+  last_sync_us = local_us();
+  last_drift_ms = millis();
+  stats.synced = true;
+  stats.syncs++;
+  stats.last_offset_us = (int32_t)constrain(offset, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+  stats.last_rtt_us = (uint32_t)s.rtt_us;
+}
+
+static void finish(bool ok)
+{
+  if (ok)
+    apply(best);
+  else
+  {
+    stats.failed++;
+    LOG_W("clock sync failed (%lu total)", (unsigned long)stats.failed);
+  }
+  radio_off();
+  state = SYNC_IDLE;
+  next_sync_ms = millis() + (ok ? stats.interval_ms : CLOCK_RETRY_MS);
+}
+
+void clock_sync_begin(const char *ssid, const char *password, int channel, clock_adjust_cb_t on_adjust)
+{
+  wifi_ssid = ssid;
+  wifi_password = password;
+  wifi_channel = channel;
+  adjust_cb = on_adjust;
+  radio_on();
+  state = SYNC_CONNECTING;
+  state_since_ms = millis();
+}
+
+void clock_sync_update()
+{
+  unsigned long now = millis();
+  if (stats.synced && now - last_drift_ms >= CLOCK_DRIFT_STEP_MS)
+  {
+    slew((int64_t)(stats.drift_ppm * (now - last_drift_ms) / 1000.0f));
+    last_drift_ms = now;
+  }
+
+  if (state == SYNC_IDLE)
+  {
+    if ((long)(now - next_sync_ms) >= 0)
+    {
+      radio_on();
+      state = SYNC_CONNECTING;
+      state_since_ms = now;
+    }
+  }
+  else if (state == SYNC_CONNECTING)
+  {
+    if (WiFi.status() == WL_CONNECTED)
+    {
+      udp.begin(0);
+      resolve_servers();
+      state = SYNC_RESOLVING;
+      state_since_ms = now;
+    }
+    else if (now - state_since_ms >= CLOCK_CONNECT_TIMEOUT_MS)
+      finish(false);
+  }
+  else if (state == SYNC_RESOLVING)
+  {
+    bool pending = false;
+    for (int i = 0; i < n_clock_servers; i++)
+      pending = pending || servers[i].pending;
+    if (!pending || now - state_since_ms >= CLOCK_RESOLVE_TIMEOUT_MS)
+    {
+      best.valid = false;
+      query = 0;
+      state = SYNC_QUERYING;
+    }
+  }
+  else
+  {
+    uint32_t addr = servers[query / CLOCK_SAMPLES_PER_SERVER].addr;
+    if (addr != 0)
+    {
+      ntp_sample_t s = ntp_query(IPAddress(addr));
+      if (s.valid && (!best.valid || s.rtt_us < best.rtt_us))
+        best = s;
+    }
+    if (++query == n_clock_servers * CLOCK_SAMPLES_PER_SERVER)
+      finish(best.valid);
+  }
+}
+
+// Whole hours east of UTC as a POSIX TZ string, which counts west
+void clock_set_utc_offset(long seconds)
+{
+  char tz[16];
+  snprintf(tz, sizeof(tz), "UTC%+ld", -seconds / 3600);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+const clock_sync_stats_t &clock_sync_stats()
+{
+  return stats;
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include "crash.h"
+
+#include <stddef.h>
+#include <esp_system.h>
+#include "alarm_scheduler.h"
+#include "telemetry.h"
+
+#ifndef MEDIBOX_HOST
+#include <esp_debug_helpers.h>
+#include <esp_private/panic_internal.h>
+#include <freertos/xtensa_context.h>
+#include <soc/cpu.h>
+#endif
+
+#define CRASH_MAGIC 0x43525348 // "CRSH"
+
+static_assert(CRASH_ALARMS >= n_alarm, "crash context too small for the alarms");
+
+// Survives the reboot; validated by magic and crc
+RTC_NOINIT_ATTR static crash_context_t saved;
+
+static crash_context_t last;
+static bool have_last = false;
+
+// Bitwise CRC-32: no table, so nothing is read from flash on the panic path
+static uint32_t IRAM_ATTR crc32(const void *data, size_t n)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  while (n--)
+  {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+#ifndef MEDIBOX_HOST
+// Same walk as esp_backtrace_print_from_frame(), into a bounded array
+static int IRAM_ATTR walk_backtrace(uint32_t pc, uint32_t sp, uint32_t next_pc)
+{
+  esp_backtrace_frame_t frame = {pc, sp, next_pc};
+  int n = 0;
+  saved.backtrace[n++] = esp_cpu_process_stack_pc(frame.pc);
+  while (n < CRASH_BACKTRACE_DEPTH && frame.next_pc != 0 && esp_backtrace_get_next_frame(&frame))
+    saved.backtrace[n++] = esp_cpu_process_stack_pc(frame.pc);
+  return n;
+}
+#else
+static int walk_backtrace(uint32_t pc, uint32_t sp, uint32_t next_pc)
+{
+  return 0; // no Xtensa frames on the host
+}
+#endif
+
+static void IRAM_ATTR capture(crash_cause_t cause, uint32_t pc, uint32_t sp, uint32_t next_pc, uint32_t exc_cause,
+                              uint32_t exc_vaddr)
+{
+  saved.cause = cause;
+  saved.reset_reason = 0;
+  saved.uptime_ms = millis();
+  saved.exc_cause = exc_cause;
+  saved.exc_vaddr = exc_vaddr;
+  saved.backtrace_depth = walk_backtrace(pc, sp, next_pc);
+  saved.trace_count = trace_copy_latest(saved.trace, CRASH_TRACE_RECORDS);
+  for (int i = 0; i < n_alarm; i++)
+  {
+    const alarm_time_t &a = alarm_time[i];
+    saved.alarms[i] = {a.next_due, a.last_due, a.snooze_due, a.alarm_state, a.snooze_count};
+  }
+  saved.magic = CRASH_MAGIC;
+  saved.crc = crc32(&saved, offsetof(crash_context_t, crc));
+}
+
+#ifndef MEDIBOX_HOST
+extern "C" void __real_esp_panic_handler(panic_info_t *info);
+
+// Runs on the panicking core with the other one halted, before the
+// panic output and reboot
+extern "C" void IRAM_ATTR __wrap_esp_panic_handler(panic_info_t *info)
+{
+  const XtExcFrame *f = (const XtExcFrame *)info->frame;
+  capture(CRASH_PANIC, f->pc, f->a1, f->a0, f->exccause, f->excvaddr);
+  __real_esp_panic_handler(info);
+}
+
+static void on_shutdown()
+{
+  esp_backtrace_frame_t frame;
+  esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+  capture(CRASH_RESTART, frame.pc, frame.sp, frame.next_pc, 0, 0);
+}
+#else
+static void on_shutdown()
+{
+  capture(CRASH_RESTART, 0, 0, 0, 0, 0);
+}
+#endif
+
+// Pick up the previous boot's record; call early in setup()
+void crash_begin()
+{
+  if (saved.magic == CRASH_MAGIC && saved.crc == crc32(&saved, offsetof(crash_context_t, crc)))
+  {
+    last = saved;
+    last.reset_reason = esp_reset_reason();
+    have_last = true;
+  }
+  saved.magic = 0;
+  esp_register_shutdown_handler(on_shutdown);
+  if (have_last)
+    crash_report(console);
+}
+
+bool crash_last(crash_context_t *out)
+{
+  if (have_last)
+    *out = last;
+  return have_last;
+}
+
+void crash_report(Print &out)
+{
+  static const char *cause_names[] = {"none", "panic", "restart"};
+  static const char *reset_names[] = {"unknown", "poweron", "ext", "sw", "panic", "int_wdt",
+                                      "task_wdt", "wdt", "deepsleep", "brownout", "sdio"};
+  if (!have_last)
+  {
+    esp_reset_reason_t r = esp_reset_reason();
+    out.printf("# crash none reset=%s\n", r <= ESP_RST_SDIO ? reset_names[r] : "?");
+    return;
+  }
+  out.printf("# crash cause=%s reset=%s uptime=%lums exccause=%lu excvaddr=0x%08lx\n",
+             cause_names[last.cause <= CRASH_RESTART ? last.cause : 0],
+             last.reset_reason <= ESP_RST_SDIO ? reset_names[last.reset_reason] : "?", (unsigned long)last.uptime_ms,
+             (unsigned long)last.exc_cause, (unsigned long)last.exc_vaddr);
+  if (last.backtrace_depth > 0)
+  {
+    out.print("Backtrace:");
+    for (int i = 0; i < last.backtrace_depth; i++)
+      out.printf(" 0x%08lx", (unsigned long)last.backtrace[i]);
+    out.println();
+  }
+  for (int i = 0; i < n_alarm; i++)
+  {
+    const crash_alarm_t &a = last.alarms[i];
+    out.printf("alarm %d state=%u next_due=%lld last_due=%lld snooze_due=%lld snoozes=%u\n", i + 1, a.alarm_state,
+               (long long)a.next_due, (long long)a.last_due, (long long)a.snooze_due, a.snooze_count);
+  }
+  for (int i = 0; i < last.trace_count; i++)
+    trace_print_record(out, last.trace[i]);
+  out.println("# end");
+}
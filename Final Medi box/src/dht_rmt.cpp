@@ -0,0 +1,153 @@
+#include "dht_rmt.h"
+
+#include "perf_trace.h"
+
+#ifndef MEDIBOX_HOST
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+#include <freertos/ringbuf.h>
+#endif
+
+#define DHT_RMT_CHANNEL RMT_CHANNEL_0
+#define DHT_START_PULSE_MS 2      // host holds the line low for >= 1 ms
+#define DHT_IDLE_THRESHOLD_US 200 // longer than any bit; ends the capture
+#define DHT_BIT_ONE_US 48         // high time of a 1 bit is ~70 us, of a 0 bit ~27 us
+#define DHT_CAPTURE_TIMEOUT_MS 20
+
+// Humidity and temperature in tenths, sign bit on temperature, then an
+// 8-bit checksum of the four data bytes
+bool dht_decode(const uint8_t data[5], float *temperature, float *humidity)
+{
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+    return false;
+  *humidity = ((data[0] << 8) | data[1]) / 10.0f;
+  float t = (((data[2] & 0x7F) << 8) | data[3]) / 10.0f;
+  *temperature = (data[2] & 0x80) ? -t : t;
+  return true;
+}
+
+bool DhtRmt::available()
+{
+  return fresh_;
+}
+
+dht_reading_t DhtRmt::lastReading()
+{
+  portENTER_CRITICAL(&mux_);
+  dht_reading_t r = reading_;
+  fresh_ = false;
+  portEXIT_CRITICAL(&mux_);
+  return r;
+}
+
+void DhtRmt::complete(const dht_reading_t &reading)
+{
+  portENTER_CRITICAL(&mux_);
+  reading_ = reading;
+  fresh_ = true;
+  busy_ = false;
+  portEXIT_CRITICAL(&mux_);
+  if (callback_)
+    callback_(reading);
+}
+
+#ifndef MEDIBOX_HOST
+
+// Turns one RMT capture into a reading. The capture holds the tail of our
+// release, the sensor's 80/80 us response and 40 data bits, each a ~50 us
+// low followed by a high whose width is the bit; the data bits are the
+// last 40 high levels.
+static bool decode_items(const rmt_item32_t *items, size_t n_items, float *temperature, float *humidity)
+{
+  uint16_t highs[96];
+  int n_highs = 0;
+  for (size_t i = 0; i < n_items; i++)
+  {
+    const rmt_item32_t &it = items[i];
+    if (it.level0 && it.duration0 && n_highs < 96)
+      highs[n_highs++] = it.duration0;
+    if (it.level1 && it.duration1 && n_highs < 96)
+      highs[n_highs++] = it.duration1;
+  }
+  if (n_highs < 40)
+    return false;
+  uint8_t data[5] = {0, 0, 0, 0, 0};
+  for (int i = 0; i < 40; i++)
+    if (highs[n_highs - 40 + i] > DHT_BIT_ONE_US)
+      data[i / 8] |= 0x80 >> (i % 8);
+  return dht_decode(data, temperature, humidity);
+}
+
+void dht_rmt_task(void *arg)
+{
+  DhtRmt *dht = (DhtRmt *)arg;
+  RingbufHandle_t rb = (RingbufHandle_t)dht->ringbuf_;
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    perf_instant("dht capture");
+
+    gpio_set_level((gpio_num_t)dht->pin_, 0);
+    vTaskDelay(pdMS_TO_TICKS(DHT_START_PULSE_MS));
+    rmt_rx_start(DHT_RMT_CHANNEL, true);
+    gpio_set_level((gpio_num_t)dht->pin_, 1); // release; the pull-up and sensor take over
+
+    dht_reading_t reading = {NAN, NAN, false, 0};
+    size_t len = 0;
+    rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(rb, &len, pdMS_TO_TICKS(DHT_CAPTURE_TIMEOUT_MS));
+    rmt_rx_stop(DHT_RMT_CHANNEL);
+    if (items)
+    {
+      float t, h;
+      if (decode_items(items, len / sizeof(rmt_item32_t), &t, &h))
+        reading = {t, h, true, 0};
+      vRingbufferReturnItem(rb, items);
+    }
+    reading.t_ms = millis();
+    dht->complete(reading);
+    perf_instant("dht done", reading.ok);
+  }
+}
+
+bool DhtRmt::setup(uint8_t pin, DHT_MODEL_t model)
+{
+  pin_ = pin;
+  rmt_config_t cfg = RMT_DEFAULT_CONFIG_RX((gpio_num_t)pin, DHT_RMT_CHANNEL);
+  cfg.clk_div = 80; // 1 us ticks
+  cfg.rx_config.idle_threshold = DHT_IDLE_THRESHOLD_US;
+  cfg.rx_config.filter_en = true;
+  cfg.rx_config.filter_ticks_thresh = 100; // APB cycles; rejects glitches under ~1.25 us
+  if (rmt_config(&cfg) != ESP_OK || rmt_driver_install(DHT_RMT_CHANNEL, 512, 0) != ESP_OK)
+    return false;
+  RingbufHandle_t rb;
+  rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &rb);
+  ringbuf_ = rb;
+
+  // Open drain on top of the RMT input so we can pull the line low
+  // ourselves for the start pulse without reconfiguring the pin
+  gpio_set_pull_mode((gpio_num_t)pin, GPIO_PULLUP_ONLY);
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_level((gpio_num_t)pin, 1);
+
+  TaskHandle_t task;
+  if (xTaskCreate(dht_rmt_task, "dht", 2048, this, 2, &task) != pdPASS)
+    return false;
+  task_ = task;
+  return true;
+}
+
+// Start a read unless one is in flight or the sensor's minimum sampling
+// period has not elapsed; the result arrives via available()/onReading()
+bool DhtRmt::request()
+{
+  unsigned long now = millis();
+  if (busy_ || task_ == nullptr || (requested_once_ && now - last_request_ms_ < (unsigned long)getMinimumSamplingPeriod()))
+    return false;
+  busy_ = true;
+  requested_once_ = true;
+  last_request_ms_ = now;
+  xTaskNotifyGive((TaskHandle_t)task_);
+  return true;
+}
+
+#endif
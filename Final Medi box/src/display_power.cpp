@@ -0,0 +1,221 @@
+#include "display_power.h"
+
+#include "events.h"
+#include "i2c_bus.h"
+#include "perf_trace.h"
+
+#define CONTRAST_NORMAL 0xCF // Adafruit_SSD1306 default with SWITCHCAPVCC
+#define CONTRAST_DIMMED 0x01
+#define SSD1306_COMMAND_BYTES 3 // address, control byte, command
+#define I2C_FAST_HZ 400000     // Adafruit_SSD1306 transfer and restore clocks
+#define I2C_RESTORE_HZ 100000
+
+unsigned long display_dim_after_ms = 30UL * 1000;
+unsigned long display_off_after_ms = 2UL * 60 * 1000;
+
+struct panel_t
+{
+  Adafruit_SSD1306 *disp;
+  TwoWire *wire;
+  uint8_t addr;
+  panel_stats_t stats;
+  unsigned long lit_since_ms;
+};
+
+static panel_t panels[2];
+static unsigned long last_activity_ms = 0;
+static int events = -1;
+
+static panel_t *find_panel(Adafruit_SSD1306 &disp)
+{
+  for (panel_t &p : panels)
+    if (p.disp == &disp)
+      return &p;
+  return nullptr;
+}
+
+static void command(panel_t &p, uint8_t c)
+{
+  p.disp->ssd1306_command(c);
+  p.stats.bytes += SSD1306_COMMAND_BYTES;
+}
+
+static void set_state(panel_t &p, panel_power_t state)
+{
+  if (p.disp == nullptr || p.stats.absent || p.stats.state == state)
+    return;
+  unsigned long now = millis();
+  if (p.stats.state == PANEL_OFF)
+  {
+    command(p, SSD1306_DISPLAYON);
+    p.lit_since_ms = now;
+  }
+  if (state == PANEL_OFF)
+  {
+    command(p, SSD1306_DISPLAYOFF);
+    p.stats.on_ms += now - p.lit_since_ms;
+  }
+  else
+  {
+    command(p, SSD1306_SETCONTRAST);
+    command(p, state == PANEL_DIMMED ? CONTRAST_DIMMED : CONTRAST_NORMAL);
+  }
+  p.stats.state = state;
+}
+
+void display_power_begin(Adafruit_SSD1306 *panel1, Adafruit_SSD1306 *panel2)
+{
+  unsigned long now = millis();
+  panels[0] = {panel1, nullptr, 0, {PANEL_ON, false, 0, 0, 0, 0, 0}, now};
+  panels[1] = {panel2, nullptr, 0, {PANEL_ON, false, 0, 0, 0, 0, 0}, now};
+  last_activity_ms = now;
+  events = event_subscribe("power", EVENT_MASK(EVENT_BUTTON) | EVENT_MASK(EVENT_ALARM));
+}
+
+// Apply idle timeouts; called from the main loop and from blocking UI loops
+void display_power_update()
+{
+  event_t e;
+  bool activity = false;
+  while (event_poll(events, &e))
+    activity = true;
+  if (activity)
+    display_power_wake();
+  unsigned long idle = millis() - last_activity_ms;
+  panel_power_t state = idle >= display_off_after_ms ? PANEL_OFF : idle >= display_dim_after_ms ? PANEL_DIMMED : PANEL_ON;
+  for (panel_t &p : panels)
+    set_state(p, state);
+}
+
+// User input, an alarm or a warning: both panels back to full brightness
+void display_power_wake()
+{
+  last_activity_ms = millis();
+  for (panel_t &p : panels)
+    set_state(p, PANEL_ON);
+}
+
+bool panel_visible(Adafruit_SSD1306 &disp)
+{
+  panel_t *p = find_panel(disp);
+  return p == nullptr || (!p->stats.absent && p->stats.state != PANEL_OFF);
+}
+
+void panel_flush(Adafruit_SSD1306 &disp)
+{
+  panel_t *p = find_panel(disp);
+  if (p != nullptr && (p->stats.absent || p->stats.state == PANEL_OFF))
+  {
+    p->stats.skipped++;
+    return;
+  }
+  uint32_t id = p != nullptr ? p - panels + 1 : 0;
+  perf_begin("oled flush", id);
+  unsigned long t0 = micros();
+  disp.display();
+  perf_end("oled flush", id);
+  if (p != nullptr)
+  {
+    if (p->wire != nullptr)
+      bus_charge(p->wire, BUS_DISPLAY, micros() - t0);
+    p->stats.flushes++;
+    p->stats.bytes += SSD1306_FLUSH_BYTES;
+  }
+}
+
+void panel_set_bus(Adafruit_SSD1306 &disp, TwoWire *wire, uint8_t addr)
+{
+  panel_t *p = find_panel(disp);
+  if (p != nullptr)
+  {
+    p->wire = wire;
+    p->addr = addr;
+  }
+}
+
+void panel_set_absent(Adafruit_SSD1306 &disp)
+{
+  panel_t *p = find_panel(disp);
+  if (p != nullptr)
+    p->stats.absent = true;
+}
+
+// Pages with col_lo > col_hi are unchanged and not sent. Pages that were
+// sent are marked clean; the rest wait for bus time in a later pass.
+void panel_flush_pages(Adafruit_SSD1306 &disp, uint8_t col_lo[8], uint8_t col_hi[8], bool budgeted)
+{
+  panel_t *p = find_panel(disp);
+  if (p == nullptr || p->wire == nullptr)
+  {
+    panel_flush(disp);
+    memset(col_lo, 0xFF, 8);
+    memset(col_hi, 0, 8);
+    return;
+  }
+  if (p->stats.absent || p->stats.state == PANEL_OFF)
+  {
+    p->stats.skipped++;
+    return;
+  }
+  const uint8_t *buffer = disp.getBuffer();
+  bool sent = false;
+  uint32_t id = p - panels + 1;
+  perf_begin("oled pages", id);
+  unsigned long t0 = micros();
+  p->wire->setClock(I2C_FAST_HZ);
+  for (int page = 0; page < 8; page++)
+  {
+    if (col_lo[page] > col_hi[page])
+      continue;
+    if (sent)
+    {
+      bus_charge(p->wire, BUS_DISPLAY, micros() - t0);
+      t0 = micros();
+      if (budgeted && !bus_available(p->wire, BUS_DISPLAY))
+        break;
+    }
+    p->wire->beginTransmission(p->addr);
+    p->wire->write((uint8_t)0x00); // command stream
+    p->wire->write((uint8_t)SSD1306_COLUMNADDR);
+    p->wire->write(col_lo[page]);
+    p->wire->write(col_hi[page]);
+    p->wire->write((uint8_t)SSD1306_PAGEADDR);
+    p->wire->write((uint8_t)page);
+    p->wire->write((uint8_t)page);
+    p->wire->endTransmission();
+    p->stats.bytes += SSD1306_WINDOW_BYTES;
+
+    const uint8_t *data = buffer + page * 128 + col_lo[page];
+    int left = col_hi[page] - col_lo[page] + 1;
+    while (left > 0)
+    {
+      int n = min(left, I2C_BUFFER_LENGTH - 1);
+      p->wire->beginTransmission(p->addr);
+      p->wire->write((uint8_t)0x40); // data stream
+      p->wire->write(data, n);
+      p->wire->endTransmission();
+      p->stats.bytes += SSD1306_CHUNK_BYTES + n;
+      data += n;
+      left -= n;
+    }
+    col_lo[page] = 0xFF;
+    col_hi[page] = 0;
+    sent = true;
+  }
+  p->wire->setClock(I2C_RESTORE_HZ);
+  bus_charge(p->wire, BUS_DISPLAY, micros() - t0);
+  perf_end("oled pages", id);
+  if (sent)
+  {
+    p->stats.flushes++;
+    p->stats.partial++;
+  }
+}
+
+panel_stats_t panel_stats(int idx)
+{
+  panel_stats_t s = panels[idx].stats;
+  if (s.state != PANEL_OFF && !s.absent)
+    s.on_ms += millis() - panels[idx].lit_since_ms;
+  return s;
+}
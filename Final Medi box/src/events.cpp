@@ -0,0 +1,127 @@
+#include "events.h"
+
+#include <atomic>
+#include "log.h"
+
+#define EVENT_RING_MASK (EVENT_RING_SIZE - 1)
+
+static_assert((EVENT_RING_SIZE & EVENT_RING_MASK) == 0, "EVENT_RING_SIZE must be a power of two");
+static_assert(sizeof(event_t) == 16, "event_t should stay one 16-byte slot");
+
+// head is written only by the producer, tail only by the subscriber
+struct event_ring_t
+{
+  event_t slot[EVENT_RING_SIZE];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  event_ring_stats_t stats;
+};
+
+struct subscriber_t
+{
+  const char *name;
+  uint32_t mask;
+  uint8_t next_producer; // round-robin start for event_poll
+  event_ring_t ring[EVENT_PRODUCERS];
+};
+
+static subscriber_t subscribers[EVENT_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+int event_subscribe(const char *name, uint32_t type_mask)
+{
+  if (subscriber_count == EVENT_MAX_SUBSCRIBERS)
+  {
+    // event_poll() on -1 never returns anything, so say which one is deaf
+    LOG_E("events: no slot for subscriber %s, raise EVENT_MAX_SUBSCRIBERS", name);
+    return -1;
+  }
+  subscriber_t &s = subscribers[subscriber_count];
+  s.name = name;
+  s.mask = type_mask;
+  return subscriber_count++;
+}
+
+static void IRAM_ATTR push(event_ring_t &r, const event_t &e)
+{
+  uint32_t head = r.head.load(std::memory_order_relaxed);
+  uint32_t depth = head - r.tail.load(std::memory_order_acquire);
+  r.stats.published++;
+  if (depth >= EVENT_RING_SIZE)
+  {
+    r.stats.dropped++;
+    return;
+  }
+  r.slot[head & EVENT_RING_MASK] = e;
+  r.head.store(head + 1, std::memory_order_release);
+  if (depth + 1 > r.stats.high_water)
+    r.stats.high_water = depth + 1;
+}
+
+static void IRAM_ATTR publish(event_producer_t producer, const event_t &e)
+{
+  for (int i = 0; i < subscriber_count; i++)
+    if (subscribers[i].mask & EVENT_MASK(e.type))
+      push(subscribers[i].ring[producer], e);
+}
+
+void IRAM_ATTR event_publish(event_producer_t producer, uint8_t type, uint8_t arg, int32_t v0, int32_t v1, uint16_t extra)
+{
+  event_t e;
+  e.type = type;
+  e.arg = arg;
+  e.extra = extra;
+  e.t_ms = millis();
+  e.value[0] = v0;
+  e.value[1] = v1;
+  publish(producer, e);
+}
+
+void event_publish_reading(event_producer_t producer, uint8_t type, uint8_t arg, float r0, float r1)
+{
+  event_t e;
+  e.type = type;
+  e.arg = arg;
+  e.extra = 0;
+  e.t_ms = millis();
+  e.reading[0] = r0;
+  e.reading[1] = r1;
+  publish(producer, e);
+}
+
+// Next event for the subscriber, taking producers in turn so a chatty
+// one cannot starve the others
+bool event_poll(int subscriber, event_t *e)
+{
+  if (subscriber < 0 || subscriber >= subscriber_count)
+    return false;
+  subscriber_t &s = subscribers[subscriber];
+  for (int i = 0; i < EVENT_PRODUCERS; i++)
+  {
+    uint8_t p = (s.next_producer + i) % EVENT_PRODUCERS;
+    event_ring_t &r = s.ring[p];
+    uint32_t tail = r.tail.load(std::memory_order_relaxed);
+    if (tail == r.head.load(std::memory_order_acquire))
+      continue;
+    *e = r.slot[tail & EVENT_RING_MASK];
+    r.tail.store(tail + 1, std::memory_order_release);
+    s.next_producer = (p + 1) % EVENT_PRODUCERS;
+    return true;
+  }
+  return false;
+}
+
+int event_subscriber_count()
+{
+  return subscriber_count;
+}
+
+const char *event_subscriber_name(int subscriber)
+{
+  return subscribers[subscriber].name;
+}
+
+event_ring_stats_t event_stats(int subscriber, event_producer_t producer)
+{
+  return subscribers[subscriber].ring[producer].stats;
+}
@@ -0,0 +1,148 @@
+#include "gestures.h"
+
+#include "events.h"
+#include "pins.h"
+
+#define MAX_ACCEL_SHIFT 8
+
+struct button_t
+{
+  uint8_t pin;
+  int8_t step; // 0: OK and Cancel
+  bool down;
+  uint32_t changed_ms; // last accepted edge
+  uint32_t next_repeat_ms;
+  uint16_t repeats; // of this hold
+  bool chorded;     // its press has been taken back by a chord
+  bool quiet;       // no repeat or long press until released
+};
+
+static button_t buttons[] = {{PB_Cancel, 0, false, 0, 0, 0, false, false},
+                             {PB_OK, 0, false, 0, 0, 0, false, false},
+                             {PB_Up, 1, false, 0, 0, 0, false, false},
+                             {PB_Down, -1, false, 0, 0, 0, false, false}};
+constexpr int n_buttons = sizeof(buttons) / sizeof(buttons[0]);
+
+static gesture_t queue[GESTURE_QUEUE];
+static uint8_t queue_head = 0, queue_count = 0;
+static int events = -1;
+
+static void push(uint8_t type, const button_t &b, int8_t step, uint32_t t_ms)
+{
+  if (queue_count == GESTURE_QUEUE)
+    return; // nobody is reading; newer input is dropped
+  queue[(queue_head + queue_count) % GESTURE_QUEUE] = {type, b.pin, step, t_ms};
+  queue_count++;
+}
+
+// Up for Down and Down for Up
+static button_t *partner(const button_t &b)
+{
+  for (button_t &o : buttons)
+    if (o.step == -b.step && o.step != 0)
+      return &o;
+  return nullptr;
+}
+
+static void edge(button_t &b, bool down, uint32_t t_ms)
+{
+  if (down == b.down || t_ms - b.changed_ms < GESTURE_DEBOUNCE_MS)
+    return;
+  b.down = down;
+  b.changed_ms = t_ms;
+  if (!down)
+    return;
+  b.repeats = 0;
+  b.chorded = false;
+  b.quiet = false;
+  b.next_repeat_ms = t_ms + GESTURE_REPEAT_DELAY_MS;
+
+  button_t *held = b.step != 0 ? partner(b) : nullptr;
+  if (held != nullptr && held->down)
+  {
+    int8_t step = held->step * GESTURE_CHORD_STEP;
+    if (!held->chorded && held->repeats == 0)
+      step -= held->step;
+    held->chorded = true;
+    held->quiet = true;
+    b.quiet = true;
+    push(GESTURE_CHORD, b, step, t_ms);
+    return;
+  }
+  push(GESTURE_PRESS, b, b.step, t_ms);
+}
+
+// Repeats and long presses of held buttons that are due by now
+static void hold(button_t &b, uint32_t now)
+{
+  if (!b.down || b.quiet)
+    return;
+  if (b.step == 0)
+  {
+    if (now - b.changed_ms >= GESTURE_LONG_MS)
+    {
+      push(GESTURE_LONG, b, 0, b.changed_ms + GESTURE_LONG_MS);
+      b.quiet = true;
+    }
+    return;
+  }
+  if ((int32_t)(now - b.next_repeat_ms) < 0)
+    return;
+  push(GESTURE_REPEAT, b, b.step, b.next_repeat_ms);
+  b.repeats++;
+  uint32_t interval = max((uint32_t)GESTURE_REPEAT_MIN_MS,
+                          (uint32_t)GESTURE_REPEAT_START_MS >> min(b.repeats / GESTURE_ACCEL_EVERY, MAX_ACCEL_SHIFT));
+  // A caller that was busy gets one repeat, not the whole backlog
+  b.next_repeat_ms = now - b.next_repeat_ms >= interval ? now + interval : b.next_repeat_ms + interval;
+}
+
+static void update()
+{
+  event_t e;
+  while (event_poll(events, &e))
+    for (button_t &b : buttons)
+      if (b.pin == e.arg)
+        edge(b, e.value[0] == LOW, e.t_ms);
+
+  uint32_t now = millis();
+  for (button_t &b : buttons)
+  {
+    // An edge dropped as bounce may have been the last one
+    bool down = digitalRead(b.pin) == LOW;
+    if (down != b.down && now - b.changed_ms >= GESTURE_DEBOUNCE_MS)
+      edge(b, down, now);
+    hold(b, now);
+  }
+}
+
+void gestures_begin()
+{
+  uint32_t now = millis();
+  for (button_t &b : buttons)
+  {
+    b.down = digitalRead(b.pin) == LOW;
+    b.changed_ms = now - GESTURE_DEBOUNCE_MS;
+    b.quiet = b.down; // held since before the boot
+  }
+  events = event_subscribe("gestures", EVENT_MASK(EVENT_BUTTON));
+}
+
+bool gesture_next(gesture_t *g)
+{
+  update();
+  if (queue_count == 0)
+    return false;
+  *g = queue[queue_head];
+  queue_head = (queue_head + 1) % GESTURE_QUEUE;
+  queue_count--;
+  return true;
+}
+
+void gesture_clear()
+{
+  update();
+  queue_count = 0;
+  for (button_t &b : buttons)
+    if (b.down)
+      b.quiet = true;
+}
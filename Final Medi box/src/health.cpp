@@ -0,0 +1,153 @@
+#include "health.h"
+
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "log.h"
+#include "pins.h"
+#include "telemetry.h"
+
+#define HEALTH_MAGIC 0x4D424F58 // "MBOX": fault_cause below is valid
+
+// Survive esp_restart() but not a power cycle
+RTC_NOINIT_ATTR static uint32_t fault_magic;
+RTC_NOINIT_ATTR static uint8_t fault_cause;
+
+static health_task_t tasks[] = {
+    {"loopTask", nullptr, 0},  // setup() and loop()
+    {"esp_timer", nullptr, 0}, // alarm and DHT completion callbacks
+    {"tiT", nullptr, 0},       // lwIP, under the NTP queries
+    {"dht", nullptr, 0},
+    {"log", nullptr, 0}};
+constexpr int n_tasks = sizeof(tasks) / sizeof(tasks[0]);
+
+static health_stats_t stats = {0, 0, 0, 0, 0, HEALTH_OK};
+static bool safe_mode = false;
+static uint32_t reported = 0; // faults already logged in safe mode
+static unsigned long last_feed_ms = 0;
+static unsigned long last_check_ms = 0;
+
+const char *health_fault_name(health_fault_t fault)
+{
+  static const char *names[] = {"ok", "watchdog", "crash", "stack", "heap", "fragmented", "display"};
+  return fault <= HEALTH_DISPLAY ? names[fault] : "?";
+}
+
+void health_begin()
+{
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (fault_magic == HEALTH_MAGIC)
+    stats.last_fault = (health_fault_t)fault_cause;
+  else if (reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT || reason == ESP_RST_WDT)
+    stats.last_fault = HEALTH_WATCHDOG;
+  else if (reason == ESP_RST_PANIC)
+    stats.last_fault = HEALTH_CRASH;
+  safe_mode = stats.last_fault != HEALTH_OK;
+  fault_magic = 0;
+
+  esp_task_wdt_init(HEALTH_WDT_TIMEOUT_S, true);
+  esp_task_wdt_add(nullptr);
+  last_feed_ms = millis();
+  if (safe_mode)
+    LOG_W("health: safe mode after %s", health_fault_name(stats.last_fault));
+}
+
+bool health_safe_mode()
+{
+  return safe_mode;
+}
+
+void health_fault(health_fault_t fault)
+{
+  if (safe_mode)
+  {
+    if (!(reported & (1u << fault)))
+      LOG_E("health: %s (safe mode, not restarting)", health_fault_name(fault));
+    reported |= 1u << fault;
+    return;
+  }
+  // Straight to the UART: the log task would not get to it before the restart
+  console.printf("health: %s, restarting into safe mode\n", health_fault_name(fault));
+  Serial.flush();
+  fault_cause = fault;
+  fault_magic = HEALTH_MAGIC;
+  esp_restart();
+}
+
+void health_halt()
+{
+  for (;;)
+  {
+    digitalWrite(LED, HIGH);
+    delay(200);
+    digitalWrite(LED, LOW);
+    delay(800);
+    esp_task_wdt_reset();
+  }
+}
+
+static void sample()
+{
+  stats.free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  stats.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  stats.largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  stats.fragmentation_pct = stats.free_heap ? 100 - (uint64_t)stats.largest_block * 100 / stats.free_heap : 0;
+  for (int i = 0; i < n_tasks; i++)
+  {
+    health_task_t &t = tasks[i];
+    if (t.handle == nullptr)
+      t.handle = xTaskGetHandle(t.name); // tasks may start after health_begin()
+    if (t.handle != nullptr)
+      t.stack_free = uxTaskGetStackHighWaterMark((TaskHandle_t)t.handle); // bytes on ESP-IDF
+  }
+}
+
+// Feed the watchdog; check the limits once per HEALTH_CHECK_MS
+void health_update()
+{
+  unsigned long now = millis();
+  stats.max_feed_gap_ms = max(stats.max_feed_gap_ms, (uint32_t)(now - last_feed_ms));
+  last_feed_ms = now;
+  esp_task_wdt_reset();
+  if (now - last_check_ms < HEALTH_CHECK_MS)
+    return;
+  last_check_ms = now;
+
+  sample();
+  for (int i = 0; i < n_tasks; i++)
+    if (tasks[i].handle != nullptr && tasks[i].stack_free < HEALTH_MIN_STACK_BYTES)
+      health_fault(HEALTH_STACK);
+  if (stats.free_heap < HEALTH_MIN_FREE_HEAP)
+    health_fault(HEALTH_HEAP);
+  else if (stats.largest_block < HEALTH_MIN_LARGEST_BLOCK)
+    health_fault(HEALTH_FRAGMENTED);
+}
+
+const health_stats_t &health_stats()
+{
+  return stats;
+}
+
+int health_task_count()
+{
+  return n_tasks;
+}
+
+const health_task_t &health_task(int idx)
+{
+  return tasks[idx];
+}
+
+void health_report(Print &out)
+{
+  sample();
+  out.printf("health %s last_fault=%s heap free=%lu min=%lu largest=%lu frag=%u%% max_gap=%lums\n",
+             safe_mode ? "safe" : "normal", health_fault_name(stats.last_fault), (unsigned long)stats.free_heap,
+             (unsigned long)stats.min_free_heap, (unsigned long)stats.largest_block, stats.fragmentation_pct,
+             (unsigned long)stats.max_feed_gap_ms);
+  for (int i = 0; i < n_tasks; i++)
+    if (tasks[i].handle != nullptr)
+      out.printf("stack %s free=%lu\n", tasks[i].name, (unsigned long)tasks[i].stack_free);
+}
@@ -0,0 +1,55 @@
+#include "i2c_bus.h"
+
+struct bus_t
+{
+  uint32_t pass_us; // used in the current pass
+  bus_stats_t stats;
+};
+
+static bus_t buses[2];
+
+static bus_t *find_bus(TwoWire *wire)
+{
+  if (wire == &Wire)
+    return &buses[0];
+  if (wire == &Wire1)
+    return &buses[1];
+  return nullptr;
+}
+
+void bus_begin_pass()
+{
+  for (bus_t &b : buses)
+    b.pass_us = 0;
+}
+
+// False once this pass's slice is used up; the caller retries next pass
+bool bus_available(TwoWire *wire, bus_user_t user)
+{
+  bus_t *b = find_bus(wire);
+  if (b == nullptr || b->pass_us < BUS_SLICE_US)
+    return true;
+  if (user == BUS_DISPLAY)
+    b->stats.display_deferred++;
+  else
+    b->stats.sensor_deferred++;
+  return false;
+}
+
+void bus_charge(TwoWire *wire, bus_user_t user, uint32_t us)
+{
+  bus_t *b = find_bus(wire);
+  if (b == nullptr)
+    return;
+  b->pass_us += us;
+  if (user == BUS_DISPLAY)
+    b->stats.display_us += us;
+  else
+    b->stats.sensor_us += us;
+  b->stats.max_pass_us = max(b->stats.max_pass_us, b->pass_us);
+}
+
+const bus_stats_t &bus_stats(int idx)
+{
+  return buses[idx].stats;
+}
@@ -0,0 +1,138 @@
+#include "input_trace.h"
+
+#include "pins.h"
+
+static const uint8_t trace_pins[] = {PB_Cancel, PB_OK, PB_Up, PB_Down};
+constexpr int n_trace_pins = sizeof(trace_pins) / sizeof(trace_pins[0]);
+
+static trace_record_t ring[TRACE_CAPACITY];
+static uint16_t ring_head = 0; // next slot to write
+static uint16_t ring_count = 0;
+static uint32_t dropped = 0;
+
+// Latest evicted record per input, so a dump always starts from a known
+// button/clock/climate state even after the ring has wrapped.
+static trace_record_t base_button[n_trace_pins];
+static trace_record_t base_climate[TRACE_SENSORS];
+static trace_record_t base_clock;
+
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR fold_into_base(const trace_record_t &rec)
+{
+  if (rec.kind == TRACE_CLIMATE)
+    base_climate[(rec.arg >> 1) % TRACE_SENSORS] = rec;
+  else if (rec.kind == TRACE_CLOCK)
+    base_clock = rec;
+  else
+  {
+    for (int i = 0; i < n_trace_pins; i++)
+      if (trace_pins[i] == rec.arg)
+        base_button[i] = rec;
+  }
+}
+
+static void IRAM_ATTR push(uint8_t kind, uint8_t arg, int16_t a, int32_t b)
+{
+  trace_record_t rec = {(uint32_t)millis(), kind, arg, a, b};
+  portENTER_CRITICAL_SAFE(&trace_mux);
+  if (ring_count == TRACE_CAPACITY)
+  {
+    fold_into_base(ring[ring_head]);
+    dropped++;
+  }
+  else
+    ring_count++;
+  ring[ring_head] = rec;
+  ring_head = (ring_head + 1) % TRACE_CAPACITY;
+  portEXIT_CRITICAL_SAFE(&trace_mux);
+}
+
+void IRAM_ATTR trace_record_button(uint8_t pin, uint8_t level)
+{
+  push(TRACE_BUTTON, pin, level, 0);
+}
+
+void trace_record_climate(uint8_t sensor, float temp, float hum)
+{
+  if (isnan(temp) || isnan(hum))
+    push(TRACE_CLIMATE, sensor << 1 | 1, 0, 0); // low bit marks a failed read
+  else
+    push(TRACE_CLIMATE, sensor << 1, (int16_t)lroundf(temp * 10), lroundf(hum * 10));
+}
+
+void trace_record_clock(uint32_t epoch)
+{
+  push(TRACE_CLOCK, 0, 0, (int32_t)epoch);
+}
+
+int IRAM_ATTR trace_copy_latest(trace_record_t *out, int max)
+{
+  int n = min((int)ring_count, max);
+  uint16_t start = (ring_head + TRACE_CAPACITY - n) % TRACE_CAPACITY;
+  for (int i = 0; i < n; i++)
+    out[i] = ring[(start + i) % TRACE_CAPACITY];
+  return n;
+}
+
+void trace_print_record(Print &out, const trace_record_t &rec)
+{
+  if (rec.kind == 0)
+    return;
+  char line[48];
+  snprintf(line, sizeof(line), "%c,%lu,%u,%d,%ld", rec.kind, (unsigned long)rec.t_ms,
+           rec.arg, rec.a, (long)rec.b);
+  out.println(line);
+}
+
+void trace_dump(Print &out)
+{
+  // Copy under the lock so ISRs can keep recording while we print
+  static trace_record_t snapshot[TRACE_CAPACITY + n_trace_pins + TRACE_SENSORS + 1];
+  int n = 0;
+  uint32_t n_dropped;
+  portENTER_CRITICAL(&trace_mux);
+  for (int i = 0; i < n_trace_pins; i++)
+    snapshot[n++] = base_button[i];
+  for (int i = 0; i < TRACE_SENSORS; i++)
+    snapshot[n++] = base_climate[i];
+  snapshot[n++] = base_clock;
+  int n_base = n;
+  uint16_t start = (ring_head + TRACE_CAPACITY - ring_count) % TRACE_CAPACITY;
+  for (int i = 0; i < ring_count; i++)
+    snapshot[n++] = ring[(start + i) % TRACE_CAPACITY];
+  n_dropped = dropped;
+  portEXIT_CRITICAL(&trace_mux);
+
+  // Base records are few; keep them in time order ahead of the ring
+  for (int i = 1; i < n_base; i++)
+    for (int j = i; j > 0 && snapshot[j].t_ms < snapshot[j - 1].t_ms; j--)
+    {
+      trace_record_t tmp = snapshot[j];
+      snapshot[j] = snapshot[j - 1];
+      snapshot[j - 1] = tmp;
+    }
+
+  out.print("# medibox-trace v1 records=");
+  out.print(n - n_base);
+  out.print(" evicted=");
+  out.println(n_dropped);
+  for (int i = 0; i < n; i++)
+    trace_print_record(out, snapshot[i]);
+  out.println("# end");
+}
+
+bool trace_parse_line(const char *line, trace_record_t &rec)
+{
+  char kind;
+  unsigned long t_ms;
+  unsigned arg;
+  int a;
+  long b;
+  if (sscanf(line, "%c,%lu,%u,%d,%ld", &kind, &t_ms, &arg, &a, &b) != 5)
+    return false;
+  if (kind != TRACE_BUTTON && kind != TRACE_CLIMATE && kind != TRACE_CLOCK)
+    return false;
+  rec = {(uint32_t)t_ms, (uint8_t)kind, (uint8_t)arg, (int16_t)a, (int32_t)b};
+  return true;
+}
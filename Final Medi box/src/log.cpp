@@ -0,0 +1,242 @@
+#include "log.h"
+
+#include <atomic>
+#include "telemetry.h"
+
+#ifdef MEDIBOX_HOST
+#include <esp_timer.h>
+#else
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_TASK_STACK 3072 // snprintf of doubles
+
+static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0, "LOG_RING_SIZE must be a power of two");
+
+// Bounded multi-producer ring: a producer claims a position by advancing
+// head with a CAS, fills the entry and publishes it through the entry's
+// sequence, so loggers in different tasks never wait for each other.
+// seq is stored relative to the entry's index so that the zeroed ring is
+// already valid before log_begin(): an entry at index i is free for
+// position pos when seq + i == pos and holds pos when seq + i == pos + 1.
+struct log_entry_t
+{
+  std::atomic<uint32_t> seq;
+  const log_site_t *site;
+  uint32_t t_ms;
+  uint32_t suppressed;
+  uint8_t n_args;
+  log_arg_t args[LOG_MAX_ARGS];
+};
+
+static log_entry_t ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> head(0);
+static std::atomic<uint32_t> tail(0); // written only by the drain
+static log_stats_t stats = {0, 0, 0, 0};
+
+// Formatted but not yet sent for lack of UART room
+static char pending[TLM_MAX_BODY];
+static size_t pending_len = 0;
+static uint8_t pending_level = 0;
+static bool have_pending = false;
+
+bool log_admit(log_site_t &site)
+{
+  uint32_t now = millis();
+  if (site.logged && now - site.last_ms < site.interval_ms)
+  {
+    site.suppressed++;
+    stats.suppressed++;
+    return false;
+  }
+  site.logged = true;
+  site.last_ms = now;
+  return true;
+}
+
+void log_submit(log_site_t &site, const log_arg_t *args, uint8_t n_args)
+{
+  uint32_t pos = head.load(std::memory_order_relaxed);
+  log_entry_t *e;
+  for (;;)
+  {
+    uint32_t idx = pos & LOG_RING_MASK;
+    e = &ring[idx];
+    int32_t dif = (int32_t)(e->seq.load(std::memory_order_acquire) + idx - pos);
+    if (dif == 0)
+    {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (dif < 0)
+    {
+      stats.dropped++; // full; the site's suppressed count carries over
+      return;
+    }
+    else
+      pos = head.load(std::memory_order_relaxed);
+  }
+  e->site = &site;
+  e->t_ms = site.last_ms;
+  e->suppressed = site.suppressed;
+  site.suppressed = 0;
+  e->n_args = n_args;
+  for (uint8_t i = 0; i < n_args; i++)
+    e->args[i] = args[i];
+  e->seq.store(pos + 1 - (pos & LOG_RING_MASK), std::memory_order_release);
+
+  uint32_t depth = pos + 1 - tail.load(std::memory_order_relaxed);
+  if (depth > stats.high_water)
+    stats.high_water = depth;
+}
+
+// printf over the captured arguments. Each conversion is formatted on its
+// own with the length modifier replaced by the captured type's, so a
+// mismatch prints a wrong number rather than reading past the arguments.
+static size_t format(const log_entry_t &e, char *out, size_t size)
+{
+  size_t len = 0;
+  uint8_t next = 0;
+  for (const char *p = e.site->fmt; *p != 0 && len + 1 < size; p++)
+  {
+    if (*p != '%')
+    {
+      out[len++] = *p;
+      continue;
+    }
+    if (p[1] == '%')
+    {
+      out[len++] = '%';
+      p++;
+      continue;
+    }
+    char spec[16];
+    size_t s = 0;
+    spec[s++] = '%';
+    for (p++; *p != 0 && strchr("-+ #0123456789.", *p) != nullptr && s < sizeof(spec) - 4; p++)
+      spec[s++] = *p;
+    while (*p != 0 && strchr("hlLqjzt", *p) != nullptr)
+      p++;
+    if (*p == 0)
+      break;
+    char conv = *p;
+    const log_arg_t *a = next < e.n_args ? &e.args[next++] : nullptr;
+    int n;
+    if (a == nullptr)
+      n = snprintf(out + len, size - len, "?");
+    else if (strchr("fFeEgGaA", conv) != nullptr)
+    {
+      spec[s++] = conv;
+      spec[s] = 0;
+      double v = a->kind == LOG_ARG_DOUBLE ? a->d : a->kind == LOG_ARG_INT ? (double)a->i : (double)a->u;
+      n = snprintf(out + len, size - len, spec, v);
+    }
+    else if (strchr("diouxXc", conv) != nullptr)
+    {
+      long long v = a->kind == LOG_ARG_INT ? (long long)a->i : a->kind == LOG_ARG_UINT ? (long long)a->u : (long long)a->d;
+      if (conv == 'c')
+      {
+        spec[s++] = 'c';
+        spec[s] = 0;
+        n = snprintf(out + len, size - len, spec, (int)v);
+      }
+      else
+      {
+        spec[s++] = 'l';
+        spec[s++] = 'l';
+        spec[s++] = conv;
+        spec[s] = 0;
+        n = snprintf(out + len, size - len, spec, v);
+      }
+    }
+    else if (conv == 's')
+    {
+      spec[s++] = 's';
+      spec[s] = 0;
+      n = snprintf(out + len, size - len, spec, a->kind == LOG_ARG_STR && a->s != nullptr ? a->s : "?");
+    }
+    else
+      n = snprintf(out + len, size - len, "?");
+    if (n > 0)
+      len = min(len + n, size - 1);
+  }
+  if (e.suppressed && len + 1 < size)
+  {
+    int n = snprintf(out + len, size - len, " (+%lu suppressed)", (unsigned long)e.suppressed);
+    if (n > 0)
+      len = min(len + n, size - 1);
+  }
+  return len;
+}
+
+// Send what is pending, then format the next entry; stop when the ring is
+// empty or the UART is full. An entry is released as soon as it has been
+// formatted, so the ring only holds unformatted messages.
+static void drain()
+{
+  for (;;)
+  {
+    if (have_pending)
+    {
+      if (!telemetry_log(pending_level, pending, pending_len))
+        return;
+      have_pending = false;
+      stats.written++;
+    }
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    uint32_t idx = pos & LOG_RING_MASK;
+    log_entry_t &e = ring[idx];
+    if (e.seq.load(std::memory_order_acquire) + idx != pos + 1)
+      return;
+    pending_len = format(e, pending, sizeof(pending));
+    pending_level = e.site->level;
+    have_pending = true;
+    e.seq.store(pos + LOG_RING_SIZE - idx, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_relaxed);
+  }
+}
+
+#ifdef MEDIBOX_HOST
+
+// No tasks on the host: a periodic timer stands in for the drain task
+static void drain_timer(void *)
+{
+  drain();
+}
+
+void log_begin()
+{
+  esp_timer_create_args_t args = {};
+  args.callback = drain_timer;
+  args.name = "log";
+  esp_timer_handle_t timer;
+  esp_timer_create(&args, &timer);
+  esp_timer_start_periodic(timer, LOG_DRAIN_MS * 1000);
+}
+
+#else
+
+static void log_task(void *)
+{
+  for (;;)
+  {
+    drain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+// Priority 1 is the loop task's: at the idle priority the drain would
+// never run, since loop() does not block
+void log_begin()
+{
+  xTaskCreate(log_task, "log", LOG_TASK_STACK, nullptr, 1, nullptr);
+}
+
+#endif
+
+const log_stats_t &log_stats()
+{
+  return stats;
+}
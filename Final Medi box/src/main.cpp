@@ -1,138 +1,339 @@
 #include <Arduino.h>
-#include <WiFi.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <DHTesp.h>
+#include "pins.h"
+#include "input_trace.h"
+#include "buttons.h"
+#include "crash.h"
+#include "events.h"
+#include "build_features.h"
+#include "health.h"
+#include "display_power.h"
+#include "ui.h"
+#include "schedule.h"
+#include "adherence.h"
+#include "alarm_scheduler.h"
+#include "climate_exposure.h"
+#include "climate_sampler.h"
+#include "clock_sync.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include "i2c_bus.h"
+#include "log.h"
+#include "boot.h"
+#include "gestures.h"
+#include "melody.h"
+#include "perf_trace.h"
 
-#define Buzzer 18
-#define LED 19
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
-#define PB_Cancel 23
-#define PB_OK 2
-#define PB_Up 4
-#define PB_Down 5
-#define DHT22_PIN 16
-#define I2C0_SDA 21 // OLED1
-#define I2C0_SCL 22 // OLED1
-#define I2C1_SDA 12 // OLED2
-#define I2C1_SCL 13 // OLED2
 #define OLED_ADDRESS 0x3C
-#define NTP_SERVER "pool.ntp.org"
+#define SHT3X_ADDRESS 0x44
+#define BME280_ADDRESS 0x76
+#define SENSOR_PAGE_MS 4000 // display2 cycles through the compartments
+#define SENSOR_FAULT_REMIND_MS 60000 // a standing sensor fault beeps again
+#define WIFI_SSID "Wokwi-GUEST"
+#define WIFI_CHANNEL 6
+#define I2C_TIMEOUT_MS 20           // per transaction, so a dead bus cannot stall the boot
+#define I2C1_BRINGUP_TIMEOUT_MS 200 // OLED2 and the I2C1 sensors
+#define ALARM_RING_TIMEOUT_MS (10UL * 60 * 1000) // unacknowledged dose counts as missed
+#define TUNE_PREVIEW_NOTES 4
 
-DHTesp dhtSensor;
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);   // OLED1 on I2C0
 Adafruit_SSD1306 display2(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire1, -1); // OLED2 on I2C1
 
 // Global Variables
-int hours = 0, minutes = 0, seconds = 0, days = 0, months = 0;
-;
+int hours = 0, minutes = 0, seconds = 0, days = 0, months = 0, years = 0;
+int64_t now_local = 0; // local seconds since 1970, see schedule.h
+bool time_valid = false;
 long utc_offset = 0; // UTC offset in seconds
 bool alarm_enable = true;
 
-struct alarm_time_t
+const climate_limits_t fridge_limits = {2, 8, 20, 90}; // refrigerated medicines
+
+struct repeat_preset_t
+{
+  const char *name;
+  uint8_t kind;
+  uint8_t days_mask;
+  uint16_t interval_min;
+};
+
+const repeat_preset_t repeat_presets[] = {
+    {"Daily", SCHEDULE_WEEKLY, SCHEDULE_EVERY_DAY, 0},
+    {"Weekdays", SCHEDULE_WEEKLY, 0x3E, 0},
+    {"Mon/Wed/Fri", SCHEDULE_WEEKLY, 0x2A, 0},
+    {"Tue/Thu", SCHEDULE_WEEKLY, 0x14, 0},
+    {"Weekends", SCHEDULE_WEEKLY, 0x41, 0},
+    {"Every 4h", SCHEDULE_INTERVAL, 0, 240},
+    {"Every 6h", SCHEDULE_INTERVAL, 0, 360},
+    {"Every 8h", SCHEDULE_INTERVAL, 0, 480},
+    {"Every 12h", SCHEDULE_INTERVAL, 0, 720}};
+constexpr int n_repeat_presets = sizeof(repeat_presets) / sizeof(repeat_presets[0]);
+
+const char *month_names[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+// Local seconds at build time, from __DATE__ ("Mmm dd yyyy") and __TIME__
+constexpr int64_t build_time()
+{
+  const char *date = __DATE__;
+  const char *time = __TIME__;
+  const char *names = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  int month = 1;
+  for (int i = 0; i < 12; i++)
+    if (date[0] == names[3 * i] && date[1] == names[3 * i + 1] && date[2] == names[3 * i + 2])
+      month = i + 1;
+  int day = (date[4] == ' ' ? 0 : date[4] - '0') * 10 + date[5] - '0';
+  int year = (date[7] - '0') * 1000 + (date[8] - '0') * 100 + (date[9] - '0') * 10 + date[10] - '0';
+  // Days since 1970 of a proleptic Gregorian date, years from March
+  int y = year - (month <= 2);
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  int64_t days = (int64_t)era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+  return days * 86400 + ((time[0] - '0') * 10 + time[1] - '0') * 3600 + ((time[3] - '0') * 10 + time[4] - '0') * 60 +
+         (time[6] - '0') * 10 + time[7] - '0';
+}
+
+// Retained screens, see ui.h
+int clock_screen, clock_time, clock_seconds, clock_date;
+int alarm_overlay, alarm_title, alarm_line, alarm_hint;
+int climate_screen, climate_name, climate_temp, climate_hum, climate_exposure_text;
+int warning_overlay, warning_text;
+int clock_events, climate_events; // event bus subscriptions of the two screens
+
+// Menu modes, numbered in the order build_menu() adds them
+enum mode_kind_t : uint8_t
 {
-  bool alarm_state;
-  int hours, minutes;
-  bool snoozed;
-  unsigned long snooze_time;
+  MODE_TIME_ZONE,
+  MODE_SET_TIME, // without WiFi time
+  MODE_SET_ALARM,
+  MODE_VIEW_ALARMS,
+  MODE_DELETE_ALARM,
+  MODE_SNOOZE,
+  MODE_DIAGNOSTICS,
+  MODE_ALARM_TUNE
 };
 
-constexpr int n_alarm = 2;
-alarm_time_t alarm_time[n_alarm] = {
-    {true, 0, 0, false, 0}, // Alarm 1
-    {false, 0, 0, false, 0} // Alarm 2
+struct menu_mode_t
+{
+  String name;
+  uint8_t kind;
+  uint8_t alarm;
 };
 
-int melody[] = {262, 294, 330, 349, 392, 440, 494, 523};
+menu_mode_t modes[4 + 3 * n_alarm];
 int current_mode = 0;
-int max_mode = 6;
-String mode_name[] = {
-    "1 - Set Time Zone", "2 - Set Alarm 1", "3 - Set Alarm 2",
-    "4 - View Alarms", "5 - Delete Alarm 1", "6 - Delete Alarm 2"};
+int max_mode = 0;
+bool leave_menu = false; // Cancel held: back out of every screen to the clock
 
 // Function Declarations
 void print_line(Adafruit_SSD1306 &disp, String text, int col, int row, int size);
+void build_menu();
+void add_mode(const String &name, uint8_t kind, int alarm = 0);
+void build_screens();
 void print_time_now();
 void update_time();
 void update_time_with_check_alarm();
+bool service_alarms();
+void on_time_sync(struct timeval *tv);
+void play_note(const tune_t &tune, uint16_t i);
 void ring_alarm(int alarm_idx);
 void go_to_menu();
 int wait_for_button_press();
+bool edit_number(const String &prefix, int &value, int lo, int hi, bool wrap, const char *suffix = "",
+                 const char *zero = nullptr, int col = 10);
 void run_mode(int mode);
 void set_time_zone();
+void set_time();
 void set_alarm(int n_alarm);
 void view_alarms();
-void delete_alarm(int n_alarm);
+void delete_alarm(int idx);
+void set_snooze();
+void show_diagnostics();
+void set_alarm_tune(int n_alarm);
+int find_repeat_preset(const dose_schedule_t &s);
 void check_temperature_humidity();
-void spinner();
+void play_warning(const tune_t &tune);
+void poll_serial_commands();
+
+// An empty write: ACKed if a device answers at addr
+static bool i2c_probe(TwoWire &wire, uint8_t addr)
+{
+  wire.beginTransmission(addr);
+  return wire.endTransmission() == 0;
+}
+
+// Everything on I2C1, brought up while setup() goes on with I2C0 (see
+// boot.h). OLED2 is only started if it answers.
+static bool i2c1_begin(void *)
+{
+  Wire1.begin(I2C1_SDA, I2C1_SCL);
+  Wire1.setTimeOut(I2C_TIMEOUT_MS);
+  bool panel = i2c_probe(Wire1, OLED_ADDRESS) && display2.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS);
+  if constexpr (feature_climate)
+    sensors_begin(&Wire1);
+  return panel;
+}
 
 // Setup
 void setup()
 {
-  Serial.begin(9600);
-
-  Wire1.begin(I2C1_SDA, I2C1_SCL); // I2C1 for OLED2
-  Wire.begin(I2C0_SDA, I2C0_SCL);  // I2C0 for OLED1
+  boot_begin();
+  boot_stage("console");
+  telemetry_begin();
+  log_begin();
+  crash_begin();
+  health_begin();
 
+  boot_stage("inputs");
   pinMode(Buzzer, OUTPUT);
   pinMode(LED, OUTPUT);
   pinMode(PB_Cancel, INPUT);
   pinMode(PB_OK, INPUT);
   pinMode(PB_Up, INPUT);
   pinMode(PB_Down, INPUT);
+  buttons_begin();
+  gestures_begin();
 
-  dhtSensor.setup(DHT22_PIN, DHTesp::DHT22);
+  // The I2C sensors are optional and skipped when not fitted, or in safe
+  // mode so the OLED buses carry nothing else. All are added before the
+  // I2C1 job starts the ones on its bus.
+  if constexpr (feature_climate)
+  {
+    sensor_add_dht22("Box", DHT22_PIN, climate_default_limits);
+    if (!health_safe_mode())
+    {
+      sensor_add_sht3x("Fridge", &Wire, SHT3X_ADDRESS, fridge_limits);
+      sensor_add_bme280("Shelf", &Wire1, BME280_ADDRESS, climate_default_limits);
+    }
+  }
+  int i2c1_job = -1;
+  if constexpr (feature_display2)
+    i2c1_job = boot_spawn("i2c1", i2c1_begin, nullptr);
 
+  // OLED1 is drawn into even when it does not answer, so only a failed
+  // buffer allocation stops the boot
+  boot_stage("oled1");
+  Wire.begin(I2C0_SDA, I2C0_SCL);
+  Wire.setTimeOut(I2C_TIMEOUT_MS);
+  bool oled1 = i2c_probe(Wire, OLED_ADDRESS);
   if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS))
   {
-    Serial.println(F("Display 1 failed"));
-    for (;;)
-      ;
+    LOG_E("Display 1 failed");
+    health_fault(HEALTH_DISPLAY);
+    health_halt();
   }
-  if (!display2.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS))
+
+  boot_stage("alarms");
+  adherence_begin();
+  alarm_scheduler_begin();
+  if constexpr (!feature_wifi_time)
   {
-    Serial.println(F("Display 2 failed"));
-    for (;;)
-      ;
+    // No time source: start from the build time until it is set by hand
+    struct timeval tv = {(time_t)build_time(), 0};
+    settimeofday(&tv, nullptr);
   }
 
-  display.display();
-  display2.display();
-  delay(500);
+  boot_stage("i2c1 wait");
+  bool oled2 = false;
+  if constexpr (feature_display2)
+    oled2 = boot_join(i2c1_job, I2C1_BRINGUP_TIMEOUT_MS);
 
-  WiFi.begin("Wokwi-GUEST", "", 6);
-  while (WiFi.status() != WL_CONNECTED)
+  // First frame: the clock kept over a soft reset, or a placeholder until
+  // the first sync
+  boot_stage("first frame");
+  display_power_begin(&display, feature_display2 ? &display2 : nullptr);
+  panel_set_bus(display, &Wire, OLED_ADDRESS);
+  if (!oled1)
   {
-    delay(250);
-    display.clearDisplay();
-    print_line(display, "Connecting to\n  WiFi...", 10, 10, 2);
-    spinner();
+    LOG_E("Display 1 not found");
+    panel_set_absent(display);
+  }
+  if constexpr (feature_display2)
+  {
+    panel_set_bus(display2, &Wire1, OLED_ADDRESS);
+    if (!oled2)
+    {
+      LOG_E("Display 2 not found");
+      panel_set_absent(display2);
+    }
   }
+  build_menu();
+  build_screens();
+  clock_events = event_subscribe("clock", EVENT_MASK(EVENT_TICK));
+  if constexpr (feature_climate)
+    climate_events = event_subscribe("climate", EVENT_MASK(EVENT_SAMPLE));
+  update_time();
+  if (time_valid)
+    print_time_now();
+  else
+    ui_set_text(clock_time, "--:--");
+  ui_refresh();
+  boot_first_frame();
 
-  display.clearDisplay();
-  print_line(display, "Connected to\n  WiFi", 10, 10, 2);
-  delay(1000);
-  configTime(utc_offset, 0, NTP_SERVER);
+  if constexpr (feature_climate)
+  {
+    boot_stage("sensors");
+    sensors_begin(&Wire);
+    sensors_begin(nullptr);
+    climate_exposure_begin();
+  }
 
-  display.clearDisplay();
-  display2.clearDisplay();
-  print_line(display, " Welcome\n    to\n  Medibox", 10, 10, 2);
+  // WiFi connects in the background, see clock_sync.h
+  if constexpr (feature_wifi_time)
+  {
+    boot_stage("wifi");
+    clock_set_utc_offset(utc_offset);
+    clock_sync_begin(WIFI_SSID, "", WIFI_CHANNEL, on_time_sync); // WiFi goes off after the first sync
+  }
+  boot_end();
+
+  if (health_safe_mode())
+  {
+    print_line(display, "Safe mode\n" + String(health_fault_name(health_stats().last_fault)), 10, 10, 2);
+    delay(2000);
+  }
 }
 
 // Loop
 void loop()
 {
-  display.clearDisplay();
+  perf_stage("health");
+  health_update();
+  if constexpr (feature_wifi_time)
+  {
+    perf_stage("clock sync");
+    clock_sync_update();
+  }
+  bus_begin_pass();
+  perf_stage("display power");
+  display_power_update();
+  perf_stage("clock");
   update_time_with_check_alarm();
-  if (digitalRead(PB_OK) == LOW)
+  perf_stage("input");
+  gesture_t g;
+  while (gesture_next(&g))
+    if (g.type == GESTURE_PRESS && g.button == PB_OK)
+    {
+      LOG_D("Go to menu");
+      go_to_menu();
+    }
+  if constexpr (feature_climate)
   {
-    delay(100);
-    Serial.println("Go to menu");
-    go_to_menu();
+    perf_stage("climate");
+    check_temperature_humidity();
   }
-  check_temperature_humidity();
+  perf_stage("ui");
+  ui_update();
+  perf_stage("adherence");
+  adherence_flush(false);
+  perf_stage("telemetry");
+  telemetry_update();
+  perf_stage("console");
+  poll_serial_commands();
+  perf_stage(nullptr);
 }
 
 void print_line(Adafruit_SSD1306 &disp, String text, int col, int row, int size)
@@ -142,315 +343,417 @@ void print_line(Adafruit_SSD1306 &disp, String text, int col, int row, int size)
   disp.setTextColor(SSD1306_WHITE);
   disp.setCursor(col, row);
   disp.println(text);
-  disp.display();
+  panel_flush(disp);
+  ui_invalidate(disp); // the retained screen is repainted when it comes back
+}
+
+void build_menu()
+{
+  if constexpr (feature_wifi_time)
+    add_mode("Set Time Zone", MODE_TIME_ZONE);
+  else
+    add_mode("Set Time", MODE_SET_TIME);
+  for (int i = 0; i < n_alarm; i++)
+    add_mode("Set Alarm " + String(i + 1), MODE_SET_ALARM, i);
+  add_mode("View Alarms", MODE_VIEW_ALARMS);
+  for (int i = 0; i < n_alarm; i++)
+    add_mode("Delete Alarm " + String(i + 1), MODE_DELETE_ALARM, i);
+  add_mode("Set Snooze", MODE_SNOOZE);
+  add_mode("Diagnostics", MODE_DIAGNOSTICS);
+  for (int i = 0; i < n_alarm; i++)
+    add_mode("Alarm " + String(i + 1) + " Tune", MODE_ALARM_TUNE, i);
+}
+
+void add_mode(const String &name, uint8_t kind, int alarm)
+{
+  modes[max_mode] = {String(max_mode + 1) + " - " + name, kind, (uint8_t)alarm};
+  max_mode++;
+}
+
+void build_screens()
+{
+  clock_screen = ui_layer(display, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, UI_PLAIN, true);
+  ui_label(clock_screen, 10, 0, 2, 6, "Time: ");
+  clock_time = ui_big_label(clock_screen, 0, 16, 3, 5, "");
+  clock_seconds = ui_big_label(clock_screen, 96, 24, 2, 2, "");
+  clock_date = ui_big_label(clock_screen, 10, 48, 2, 6, "");
+
+  alarm_overlay = ui_layer(display, 0, 16, SCREEN_WIDTH, 48, UI_FRAMED, false);
+  alarm_title = ui_label(alarm_overlay, 6, 19, 2, 9, "Medicine");
+  alarm_line = ui_label(alarm_overlay, 6, 35, 2, 9, "");
+  alarm_hint = ui_label(alarm_overlay, 6, 53, 1, 19, "");
+
+  if constexpr (!feature_climate)
+    return;
+  climate_screen = ui_layer(display2, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, UI_PLAIN, true);
+  climate_name = ui_label(climate_screen, 0, 0, 2, 10, "");
+  ui_label(climate_screen, 0, 16, 2, 2, "T:");
+  climate_temp = ui_value(climate_screen, 30, 16, 2, 7, 2, "C");
+  ui_label(climate_screen, 0, 32, 2, 2, "H:");
+  climate_hum = ui_value(climate_screen, 30, 32, 2, 7, 2, "%");
+  climate_exposure_text = ui_label(climate_screen, 0, 53, 1, UI_TEXT_MAX, "");
+
+  warning_overlay = ui_layer(display2, 0, 50, SCREEN_WIDTH, 14, UI_INVERTED, false);
+  warning_text = ui_label(warning_overlay, 3, 53, 1, 20, "");
 }
 
 void print_time_now()
 {
-  display.clearDisplay();
-  display.setTextSize(2);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(10, 00);
-  display.print("Time: ");
-  display.setTextSize(2);
-  display.setCursor(10, 20);
-  if (hours < 10)
-    display.print("0");
-  display.print(hours);
-  display.print(":");
-  if (minutes < 10)
-    display.print("0");
-  display.print(minutes);
-  display.print(":");
-  if (seconds < 10)
-    display.print("0");
-  display.print(seconds);
-
-  display.setCursor(10, 40);
-  if (months == 1)
-    display.print("Jan");
-  else if (months == 2)
-    display.print("Feb");
-  else if (months == 3)
-    display.print("Mar");
-  else if (months == 4)
-    display.print("Apr");
-  else if (months == 5)
-    display.print("May");
-  else if (months == 6)
-    display.print("Jun");
-  else if (months == 7)
-    display.print("Jul");
-  else if (months == 8)
-    display.print("Aug");
-  else if (months == 9)
-    display.print("Sep");
-  else if (months == 10)
-    display.print("Oct");
-  else if (months == 11)
-    display.print("Nov");
-  else if (months == 12)
-    display.print("Dec");
-  display.print(":");
-  display.print(days);
-
-  display.display();
+  char text[8];
+  snprintf(text, sizeof(text), "%02d:%02d", hours, minutes);
+  ui_set_text(clock_time, text);
+  snprintf(text, sizeof(text), "%02d", seconds);
+  ui_set_text(clock_seconds, text);
+  if (months >= 1 && months <= 12)
+  {
+    snprintf(text, sizeof(text), "%s %d", month_names[months - 1], days);
+    ui_set_text(clock_date, text);
+  }
 }
 
 void update_time()
 {
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo))
-  {
-    Serial.println("Failed to obtain time");
-    return;
-  }
+  if (!getLocalTime(&timeinfo, 0))
+    return; // before the first clock sync
   hours = timeinfo.tm_hour;
   minutes = timeinfo.tm_min;
   seconds = timeinfo.tm_sec;
   days = timeinfo.tm_mday;
   months = timeinfo.tm_mon + 1;
+  years = timeinfo.tm_year + 1900;
+  now_local = local_seconds(years, months, days, hours, minutes, seconds);
+  time_valid = true;
 }
 
 void update_time_with_check_alarm()
 {
+  static int64_t last_tick = -1;
   update_time();
-  print_time_now();
+  if (time_valid && now_local != last_tick)
+  {
+    last_tick = now_local;
+    event_publish(PRODUCER_LOOP, EVENT_TICK, 0, (int32_t)now_local);
+  }
+  event_t e;
+  while (event_poll(clock_events, &e))
+    print_time_now();
 
-  if (alarm_enable)
+  if (alarm_enable && time_valid)
   {
+    service_alarms();
+    alarm_enable = false;
     for (int i = 0; i < n_alarm; i++)
-    {
-      if (alarm_time[i].alarm_state)
-      {
-        if (alarm_time[i].hours == hours && alarm_time[i].minutes == minutes && !alarm_time[i].snoozed)
-        {
-          Serial.println("Alarm " + String(i) + " Triggered!");
-          ring_alarm(i);
-        }
-        if (alarm_time[i].snoozed && millis() - alarm_time[i].snooze_time >= 300000)
-        { // 5 min snooze
-          alarm_time[i].snoozed = false;
-          if (alarm_time[i].hours == hours && alarm_time[i].minutes == minutes)
-          {
-            ring_alarm(i);
-          }
-        }
-      }
-    }
-    alarm_enable = alarm_time[0].alarm_state || alarm_time[1].alarm_state;
-    Serial.print("Alarm state: ");
-    Serial.println(alarm_enable ? "ON" : "OFF");
+      alarm_enable = alarm_enable || alarm_time[i].alarm_state;
   }
 }
 
+// Ring every alarm that has come due, including any whose deadline passed
+// while a blocking screen was up. Returns true if anything rang.
+bool service_alarms()
+{
+  if (!alarm_enable || !alarm_scheduler_pending())
+    return false;
+  bool rang = false;
+  int alarm_idx;
+  int64_t due;
+  while (alarm_scheduler_next(&alarm_idx, &due))
+  {
+    alarm_scheduler_record_latency(due);
+    event_publish(PRODUCER_LOOP, EVENT_ALARM, alarm_idx, (int32_t)due);
+    perf_instant("alarm fire", alarm_idx);
+    ring_alarm(alarm_idx);
+    rang = true;
+  }
+  alarm_scheduler_rearm();
+  return rang;
+}
+
+// The clock was stepped; slewed corrections need no notice
+void on_time_sync(struct timeval *tv)
+{
+  trace_record_clock((uint32_t)tv->tv_sec);
+  event_publish(PRODUCER_LOOP, EVENT_CLOCK, 0, (int32_t)tv->tv_sec);
+}
+
+// One note straight from the packed tune, then the gap after it
+void play_note(const tune_t &tune, uint16_t i)
+{
+  uint16_t hz = melody_note_hz(tune.notes[i]);
+  if (hz != 0)
+    tone(Buzzer, hz);
+  delay(melody_note_ms(tune.notes[i], tune.bpm));
+  noTone(Buzzer);
+  delay(MELODY_GAP_MS);
+}
+
 void ring_alarm(int alarm_idx)
 {
-  print_line(display, " Medicine\n   Time!\nAlarm " + String(alarm_idx + 1), 10, 10, 2);
+  display_power_update(); // takes the EVENT_ALARM and wakes the panels
+  print_time_now();       // the clock screen may be stale if a menu was up
+  ui_set_text(alarm_title, "Medicine");
+  ui_set_text(alarm_line, ("Alarm " + String(alarm_idx + 1)).c_str());
+  ui_set_text(alarm_hint, "OK=snooze X=taken");
+  ui_show(alarm_overlay, true);
+  ui_refresh();
+  gesture_clear(); // only presses made while it rings answer the alarm
+  const tune_t &tune = tunes[alarm_time[alarm_idx].tune];
+  unsigned long ring_start = millis();
   bool stopped = false;
   while (!stopped)
   {
+    if (millis() - ring_start >= ALARM_RING_TIMEOUT_MS)
+    {
+      digitalWrite(LED, LOW);
+      noTone(Buzzer);
+      update_time();
+      adherence_record(alarm_idx, alarm_time[alarm_idx].last_due, DOSE_MISSED, now_local - alarm_time[alarm_idx].last_due);
+      break;
+    }
     digitalWrite(LED, HIGH);
-    for (int i = 0; i < 8; i++)
+    for (uint16_t i = 0; i < tune.n_notes; i++)
     {
-      if (digitalRead(PB_Cancel) == LOW)
-      { // Stop
-        delay(200);
+      int pressed = -1;
+      gesture_t g;
+      while (pressed < 0 && gesture_next(&g))
+        if (g.type == GESTURE_PRESS)
+          pressed = g.button;
+      if (pressed == PB_Cancel)
+      { // Stop: dose taken, the schedule moves on to its next dose
         stopped = true;
         digitalWrite(LED, LOW);
         noTone(Buzzer);
-        alarm_time[alarm_idx].alarm_state = false;
+        update_time();
+        adherence_record(alarm_idx, alarm_time[alarm_idx].last_due, DOSE_TAKEN, now_local - alarm_time[alarm_idx].last_due);
         break;
       }
-      if (digitalRead(PB_OK) == LOW)
-      { // Snooze
-        delay(200);
+      if (pressed == PB_OK)
+      { // Snooze, unless this dose has used them all up
+        noTone(Buzzer);
+        if (!alarm_scheduler_snooze(alarm_idx))
+        {
+          ui_set_text(alarm_hint, "No more snoozes");
+          ui_refresh();
+          break;
+        }
         stopped = true;
         digitalWrite(LED, LOW);
-        noTone(Buzzer);
-        alarm_time[alarm_idx].snoozed = true;
-        alarm_time[alarm_idx].snooze_time = millis();
-        print_line(display, "Snoozed 5 min", 10, 10, 2);
+        update_time();
+        adherence_record(alarm_idx, alarm_time[alarm_idx].last_due, DOSE_SNOOZED, now_local - alarm_time[alarm_idx].last_due);
+        ui_set_text(alarm_title, "Snoozed");
+        ui_set_text(alarm_line, (String(snooze_minutes) + " min").c_str());
+        ui_set_text(alarm_hint, "");
+        ui_refresh();
         delay(1000);
         break;
       }
-      tone(Buzzer, melody[i]);
-      delay(500);
-      noTone(Buzzer);
-      delay(50);
+      health_update();
+      play_note(tune, i);
     }
   }
-  display.clearDisplay();
+  gesture_clear();
+  ui_show(alarm_overlay, false);
 }
 
 void go_to_menu()
 {
   print_line(display, "Menu", 10, 10, 2);
   delay(1000);
-  while (digitalRead(PB_Cancel) == HIGH)
+  gesture_clear(); // presses during the splash are not menu input
+  leave_menu = false;
+  while (!leave_menu)
   {
-    display.clearDisplay();
-    print_line(display, mode_name[current_mode], 10, 10, 2);
+    print_line(display, modes[current_mode].name, 10, 10, 2);
     int pressed = wait_for_button_press();
     if (pressed == PB_Up)
-    {
-      delay(100);
       current_mode = (current_mode + 1) % max_mode;
-    }
     else if (pressed == PB_Down)
-    {
-      delay(100);
       current_mode = (current_mode - 1 + max_mode) % max_mode;
-    }
     else if (pressed == PB_OK)
     {
-      delay(100);
-      Serial.println("Run mode: " + String(current_mode));
+      LOG_D("Run mode: %d", current_mode);
       run_mode(current_mode);
     }
     else if (pressed == PB_Cancel)
-    {
-      delay(100);
       break;
-    }
   }
 }
 
+// Presses and Up/Down repeats; -1 after an alarm rang over the screen. A
+// long Cancel is a Cancel that also sets leave_menu: its press has already
+// backed out of one screen, and every screen above it backs out in turn.
 int wait_for_button_press()
 {
   while (true)
   {
-    if (digitalRead(PB_Cancel) == LOW)
+    gesture_t g;
+    while (gesture_next(&g))
+      if (g.type == GESTURE_PRESS || g.type == GESTURE_REPEAT)
+        return g.button;
+      else if (g.type == GESTURE_LONG && g.button == PB_Cancel)
+      {
+        leave_menu = true;
+        return PB_Cancel;
+      }
+    update_time();
+    health_update();
+    display_power_update();
+    if (service_alarms())
+      return -1; // redraw whatever screen was waiting
+  }
+}
+
+// Up and Down step the value by the gesture's step: one per press, held
+// for accelerating repeats, or ten with the other button as a chord (see
+// gestures.h). OK keeps the value, Cancel returns false, and a long
+// Cancel also leaves the menu. zero, if given, is shown in place of 0.
+bool edit_number(const String &prefix, int &value, int lo, int hi, bool wrap, const char *suffix, const char *zero,
+                 int col)
+{
+  int v = value;
+  bool redraw = true;
+  while (true)
+  {
+    if (redraw)
+      print_line(display, prefix + (v == 0 && zero != nullptr ? String(zero) : String(v) + suffix), col, 10, 2);
+    redraw = false;
+    gesture_t g;
+    if (!gesture_next(&g))
     {
-      delay(100);
-      return PB_Cancel;
+      update_time();
+      health_update();
+      display_power_update();
+      redraw = service_alarms();
+      continue;
     }
-    if (digitalRead(PB_OK) == LOW)
+    if (g.step != 0)
     {
-      delay(100);
-      return PB_OK;
+      int span = hi - lo + 1;
+      v = wrap ? lo + ((v - lo + g.step) % span + span) % span : constrain(v + g.step, lo, hi);
+      redraw = true;
     }
-    if (digitalRead(PB_Up) == LOW)
+    else if (g.type == GESTURE_PRESS && g.button == PB_OK)
     {
-      delay(100);
-      return PB_Up;
+      value = v;
+      return true;
     }
-    if (digitalRead(PB_Down) == LOW)
+    else if (g.type == GESTURE_PRESS && g.button == PB_Cancel)
+      return false;
+    else if (g.type == GESTURE_LONG && g.button == PB_Cancel)
     {
-      delay(100);
-      return PB_Down;
+      leave_menu = true;
+      return false;
     }
-    update_time();
   }
 }
 
 void run_mode(int mode)
 {
-  if (mode == 0)
+  const menu_mode_t &m = modes[mode];
+  if (m.kind == MODE_TIME_ZONE)
     set_time_zone();
-  else if (mode == 1 || mode == 2)
-    set_alarm(mode - 1);
-  else if (mode == 3)
+  else if (m.kind == MODE_SET_TIME)
+    set_time();
+  else if (m.kind == MODE_SET_ALARM)
+    set_alarm(m.alarm);
+  else if (m.kind == MODE_VIEW_ALARMS)
     view_alarms();
-  else if (mode == 4 || mode == 5)
-    delete_alarm(mode - 4);
+  else if (m.kind == MODE_DELETE_ALARM)
+    delete_alarm(m.alarm);
+  else if (m.kind == MODE_SNOOZE)
+    set_snooze();
+  else if (m.kind == MODE_DIAGNOSTICS)
+    show_diagnostics();
+  else if (m.kind == MODE_ALARM_TUNE)
+    set_alarm_tune(m.alarm);
 }
 
 void set_time_zone()
 {
   int temp_offset = utc_offset / 3600; // Convert seconds to hours
-  while (true)
-  {
-    print_line(display, "UTC Offset:\n" + String(temp_offset) + "h", 00, 10, 2);
-    int pressed = wait_for_button_press();
-    if (pressed == PB_Up)
-    {
-      temp_offset = min(temp_offset + 1, 14);
-      delay(100);
-    }
-    else if (pressed == PB_Down)
-    {
-      temp_offset = max(temp_offset - 1, -12);
-      delay(100);
-    }
-    else if (pressed == PB_OK)
-    {
-      utc_offset = temp_offset * 3600;
-      configTime(utc_offset, 0, NTP_SERVER);
-      print_line(display, "Time Zone Set", 10, 10, 2);
-      delay(1000);
-      break;
-    }
-    else if (pressed == PB_Cancel)
-    {
-      delay(100);
-      break;
-    }
-  }
+  if (!edit_number("UTC Offset:\n", temp_offset, -12, 14, false, "h", nullptr, 0))
+    return;
+  utc_offset = temp_offset * 3600;
+  if constexpr (feature_wifi_time)
+    clock_set_utc_offset(utc_offset);
+  event_publish(PRODUCER_LOOP, EVENT_CONFIG, CONFIG_TIME_ZONE, utc_offset);
+  print_line(display, "Time Zone Set", 10, 10, 2);
+  delay(1000);
+}
+
+// The clock without WiFi time: set by hand, keeping the date
+void set_time()
+{
+  int temp_hours = hours;
+  if (!edit_number("Time\nHour: ", temp_hours, 0, 23, true))
+    return;
+  int temp_minutes = minutes;
+  if (!edit_number("Time\nMin: ", temp_minutes, 0, 59, true))
+    return;
+  // No time zone is set without WiFi time, so local time is the clock
+  struct timeval tv = {(time_t)local_seconds(years, months, days, temp_hours, temp_minutes, 0), 0};
+  settimeofday(&tv, nullptr);
+  on_time_sync(&tv);
+  print_line(display, "Time Set", 10, 10, 2);
+  delay(1000);
 }
 
 void set_alarm(int n_alarm)
 {
-  int temp_hours = alarm_time[n_alarm].hours;
+  dose_schedule_t schedule = alarm_time[n_alarm].schedule;
+  String title = "Alarm " + String(n_alarm + 1) + "\n";
+  int temp_hours = schedule.start_minute / 60;
+  if (!edit_number(title + "Hour: ", temp_hours, 0, 23, true))
+    return;
+  int temp_minutes = schedule.start_minute % 60;
+  if (!edit_number(title + "Min: ", temp_minutes, 0, 59, true))
+    return;
+
+  int temp_repeat = find_repeat_preset(schedule);
+  if (temp_repeat < 0)
+    temp_repeat = 0;
   while (true)
   {
-    print_line(display, "Alarm " + String(n_alarm + 1) + "\nHour: " + String(temp_hours), 10, 10, 2);
+    print_line(display, title + "Repeat:\n" + repeat_presets[temp_repeat].name, 10, 10, 2);
     int pressed = wait_for_button_press();
     if (pressed == PB_Up)
-    {
-      temp_hours = (temp_hours + 1) % 24;
-      delay(100);
-    }
+      temp_repeat = (temp_repeat + 1) % n_repeat_presets;
     else if (pressed == PB_Down)
-    {
-      temp_hours = (temp_hours - 1 + 24) % 24;
-      delay(100);
-    }
+      temp_repeat = (temp_repeat - 1 + n_repeat_presets) % n_repeat_presets;
     else if (pressed == PB_OK)
-    {
-      alarm_time[n_alarm].hours = temp_hours;
-      delay(100);
       break;
-    }
     else if (pressed == PB_Cancel)
-    {
-
-      delay(100);
       return;
-    }
   }
 
-  int temp_minutes = alarm_time[n_alarm].minutes;
-  while (true)
+  int temp_days = 0; // 0 = no end date
+  if (!edit_number(title + "For: ", temp_days, 0, 90, true, "d", "ever"))
+    return;
+  int32_t today = (int32_t)(now_local / 86400);
+  schedule.kind = repeat_presets[temp_repeat].kind;
+  schedule.days_mask = repeat_presets[temp_repeat].days_mask;
+  schedule.interval_min = repeat_presets[temp_repeat].interval_min;
+  schedule.start_minute = temp_hours * 60 + temp_minutes;
+  schedule.first_day = today;
+  schedule.last_day = temp_days == 0 ? SCHEDULE_OPEN_END : today + temp_days - 1;
+  alarm_time[n_alarm].schedule = schedule;
+  alarm_time[n_alarm].alarm_state = true;
+  alarm_scheduler_cancel_snooze(n_alarm);
+  alarm_enable = true;
+  event_publish(PRODUCER_LOOP, EVENT_CONFIG, CONFIG_ALARM, n_alarm);
+  print_line(display, "Alarm " + String(n_alarm + 1) + " Set", 10, 10, 2);
+  delay(1000);
+}
+
+int find_repeat_preset(const dose_schedule_t &s)
+{
+  for (int i = 0; i < n_repeat_presets; i++)
   {
-    print_line(display, "Alarm " + String(n_alarm + 1) + "\nMin: " + String(temp_minutes), 10, 10, 2);
-    int pressed = wait_for_button_press();
-    if (pressed == PB_Up)
-    {
-      temp_minutes = (temp_minutes + 1) % 60;
-      delay(100);
-    }
-    else if (pressed == PB_Down)
-    {
-      temp_minutes = (temp_minutes - 1 + 60) % 60;
-      delay(100);
-    }
-    else if (pressed == PB_OK)
-    {
-      alarm_time[n_alarm].minutes = temp_minutes;
-      alarm_time[n_alarm].alarm_state = true;
-      alarm_time[n_alarm].snoozed = false;
-      alarm_enable = true;
-      print_line(display, "Alarm " + String(n_alarm + 1) + " Set", 10, 10, 2);
-      delay(1000);
-      break;
-    }
-    else if (pressed == PB_Cancel)
-    {
-      delay(100);
-      return;
-    }
+    const repeat_preset_t &p = repeat_presets[i];
+    if (p.kind == s.kind && (s.kind == SCHEDULE_INTERVAL ? p.interval_min == s.interval_min : p.days_mask == s.days_mask))
+      return i;
   }
+  return -1;
 }
 
 void view_alarms()
@@ -464,71 +767,368 @@ void view_alarms()
   {
     if (alarm_time[i].alarm_state)
     {
+      int alarm_hours = alarm_time[i].schedule.start_minute / 60;
+      int alarm_minutes = alarm_time[i].schedule.start_minute % 60;
+      int preset = find_repeat_preset(alarm_time[i].schedule);
+      display.setTextSize(2);
       display.setCursor(0, i * 30);
       display.print("A" + String(i + 1) + ": ");
-      if (alarm_time[i].hours < 10)
+      if (alarm_hours < 10)
         display.print("0");
-      display.print(alarm_time[i].hours);
+      display.print(alarm_hours);
       display.print(":");
-      if (alarm_time[i].minutes < 10)
+      if (alarm_minutes < 10)
         display.print("0");
-      display.print(alarm_time[i].minutes);
+      display.print(alarm_minutes);
+      display.setTextSize(1);
+      display.setCursor(0, i * 30 + 17);
+      display.print(preset < 0 ? "Custom" : repeat_presets[preset].name);
+      if (alarm_time[i].schedule.last_day != SCHEDULE_OPEN_END)
+        display.print(", " + String(alarm_time[i].schedule.last_day - alarm_time[i].schedule.first_day + 1) + " days");
     }
   }
-  display.display();
+  panel_flush(display);
+  ui_invalidate(display);
   delay(3000);
 }
 
-void delete_alarm(int n_alarm)
+void delete_alarm(int idx)
 {
-  alarm_time[n_alarm].alarm_state = false;
-  alarm_time[n_alarm].snoozed = false;
-  print_line(display, "Alarm " + String(n_alarm + 1) + "\nDeleted", 10, 10, 2);
+  alarm_time[idx].alarm_state = false;
+  alarm_scheduler_cancel_snooze(idx);
+  print_line(display, "Alarm " + String(idx + 1) + "\nDeleted", 10, 10, 2);
   delay(1000);
-  alarm_enable = alarm_time[0].alarm_state || alarm_time[1].alarm_state;
+  alarm_enable = false;
+  for (int i = 0; i < n_alarm; i++)
+    alarm_enable = alarm_enable || alarm_time[i].alarm_state;
+  event_publish(PRODUCER_LOOP, EVENT_CONFIG, CONFIG_ALARM, idx);
+}
+
+void set_snooze()
+{
+  int temp_minutes = snooze_minutes;
+  if (!edit_number("Snooze:\n", temp_minutes, 1, 30, false, " min"))
+    return;
+  int temp_limit = snooze_limit;
+  if (!edit_number("Max snoozes\nper dose:\n", temp_limit, 0, 5, false))
+    return;
+  snooze_minutes = temp_minutes;
+  snooze_limit = temp_limit;
+  event_publish(PRODUCER_LOOP, EVENT_CONFIG, CONFIG_SNOOZE, snooze_minutes, snooze_limit);
+  print_line(display, "Snooze Set", 10, 10, 2);
+  delay(1000);
+}
+
+// Up/Down go through the tunes, playing the first notes of each; OK keeps it
+void set_alarm_tune(int n_alarm)
+{
+  int temp_tune = alarm_time[n_alarm].tune;
+  bool preview = false;
+  while (true)
+  {
+    print_line(display, "Alarm " + String(n_alarm + 1) + "\nTune:\n" + tunes[temp_tune].name, 10, 10, 2);
+    for (uint16_t i = 0; preview && i < min(tunes[temp_tune].n_notes, (uint16_t)TUNE_PREVIEW_NOTES); i++)
+      play_note(tunes[temp_tune], i);
+    preview = false;
+    int pressed = wait_for_button_press();
+    if (pressed == PB_Up || pressed == PB_Down)
+    {
+      temp_tune = (temp_tune + (pressed == PB_Up ? 1 : n_tunes - 1)) % n_tunes;
+      preview = true;
+    }
+    else if (pressed == PB_OK)
+    {
+      alarm_time[n_alarm].tune = temp_tune;
+      print_line(display, "Tune Set", 10, 10, 2);
+      delay(1000);
+      break;
+    }
+    else if (pressed == PB_Cancel)
+      break;
+  }
+}
+
+// Heap, fragmentation and the tightest task stack, until a button press
+void show_diagnostics()
+{
+  health_report(console); // also refreshes the figures
+  const health_stats_t &h = health_stats();
+  const health_task_t *tight = nullptr;
+  for (int i = 0; i < health_task_count(); i++)
+    if (health_task(i).handle != nullptr && (tight == nullptr || health_task(i).stack_free < tight->stack_free))
+      tight = &health_task(i);
+  String text = String(health_safe_mode() ? "Diagnostics: SAFE" : "Diagnostics") +
+                "\nHeap " + String(h.free_heap / 1024) + "k min " + String(h.min_free_heap / 1024) + "k" +
+                "\nBlock " + String(h.largest_block / 1024) + "k frag " + String(h.fragmentation_pct) + "%";
+  if (tight != nullptr)
+    text += "\nStack " + String(tight->name) + " " + String(tight->stack_free);
+  text += "\nMax gap " + String(h.max_feed_gap_ms) + "ms";
+  text += "\nLast fault " + String(health_fault_name(h.last_fault));
+  print_line(display, text, 0, 0, 1);
+  wait_for_button_press();
 }
 
+// Poll the sensors and show one compartment at a time on display2; a
+// compartment out of range is pinned there with the warning banner
 void check_temperature_humidity()
 {
-  delay(dhtSensor.getMinimumSamplingPeriod());
-  float temp = dhtSensor.getTemperature();
-  float hum = dhtSensor.getHumidity();
-
-  display2.clearDisplay();
-  display2.setTextSize(2);
-  display2.setTextColor(SSD1306_WHITE);
-  display2.setCursor(0, 0);
-  display2.print("Temp: ");
-  display2.setCursor(30, 15);
-  display2.print(temp);
-  display2.print(" C");
-  display2.setCursor(0, 30);
-  display2.print("Hum: ");
-  display2.setCursor(30, 45);
-  display2.print(hum);
-  display2.print(" %");
-
-  if (temp < 24 || temp > 32 || hum < 65 || hum > 80)
+  if constexpr (feature_climate)
   {
-    tone(Buzzer, melody[7]);
-    digitalWrite(LED, HIGH);
-    delay(500);
-    noTone(Buzzer);
-    digitalWrite(LED, LOW);
-    delay(500);
-    print_line(display2, "Warning!\nTemp/Hum\nOut of Range", 10, 00, 2);
-    delay(1000);
+    static int shown = 0;
+    static unsigned long shown_since = 0;
+    static int alert = -1, fault = -1, forecast = -1;
+    static climate_forecast_t due;
+    static int reminded = -1, announced = -1;
+    static unsigned long reminded_ms = 0;
+    sensors_poll();
+
+    // Ranges, faults and forecasts only change with a new reading. A
+    // faulty sensor's readings are not checked against its limits.
+    climate_forecast_t f;
+    event_t e;
+    bool sampled = false;
+    while (event_poll(climate_events, &e))
+    {
+      climate_exposure_update(e.arg, e.reading[0], e.reading[1], e.t_ms);
+      sampled = true;
+    }
+    if (sampled)
+    {
+      alert = fault = forecast = -1;
+      for (int i = 0; i < sensor_count(); i++)
+      {
+        const sensor_t &c = sensor(i);
+        if (!c.present)
+          continue;
+        if (sensor_faulty(c))
+        {
+          if (fault < 0)
+            fault = i;
+        }
+        else if (!sensor_in_range(c))
+        {
+          if (alert < 0)
+            alert = i;
+        }
+        else if (climate_sampler_forecast(c.sampler, &f) && (forecast < 0 || f.seconds < due.seconds))
+        {
+          forecast = i;
+          due = f;
+        }
+      }
+    }
+
+    if (alert >= 0)
+      shown = alert;
+    else if (fault >= 0)
+      shown = fault;
+    else if (forecast >= 0)
+      shown = forecast;
+    else if (millis() - shown_since >= SENSOR_PAGE_MS)
+    {
+      for (int step = 1; step <= sensor_count(); step++)
+      {
+        int next = (shown + step) % sensor_count();
+        if (sensor(next).present)
+        {
+          shown = next;
+          break;
+        }
+      }
+      shown_since = millis();
+    }
+
+    const sensor_t &s = sensor(shown);
+    ui_set_text(climate_name, s.name);
+    ui_set_value(climate_temp, s.temp);
+    ui_set_value(climate_hum, s.hum);
+
+    // Today's MKT and degree-minutes outside the limits, under the banner
+    const exposure_t &today = climate_exposure(shown, EXPOSURE_DAY);
+    char line[UI_TEXT_MAX + 1] = "MKT --";
+    if (today.seconds > 0)
+      snprintf(line, sizeof(line), "MKT %.1fC out %.0fCmin", exposure_mkt(today), today.temp_above + today.temp_below);
+    ui_set_text(climate_exposure_text, line);
+
+    // Out of range warns on every pass; a fault beeps when it is raised
+    // and then every SENSOR_FAULT_REMIND_MS; a forecast crossing only once
+    ui_show(warning_overlay, alert >= 0 || fault >= 0 || forecast >= 0);
+    if (alert >= 0)
+    {
+      ui_set_text(warning_text, (String(s.name) + " out of range").c_str());
+      display_power_wake();
+      ui_refresh();
+      play_warning(warning_tune);
+    }
+    else if (fault >= 0)
+    {
+      ui_set_text(warning_text, (String(s.name) + " sensor fault").c_str());
+      if (fault != reminded || millis() - reminded_ms >= SENSOR_FAULT_REMIND_MS)
+      {
+        reminded = fault;
+        reminded_ms = millis();
+        display_power_wake();
+        ui_refresh();
+        play_warning(fault_tune);
+      }
+    }
+    else
+      reminded = -1;
+
+    if (alert < 0 && fault < 0 && forecast >= 0)
+    {
+      unsigned long minutes = (unsigned long)ceilf(due.seconds / 60);
+      const char *unit = due.channel == CLIMATE_TEMP ? "C" : "%";
+      char text[24];
+      snprintf(text, sizeof(text), "%s %.0f%s in %lu min", s.name, due.limit, unit, minutes);
+      ui_set_text(warning_text, text);
+      if (forecast != announced)
+      {
+        announced = forecast;
+        LOG_W("Sensor %s: %.0f%s in %lu min", s.name, due.limit, unit, minutes);
+        display_power_wake();
+        ui_refresh();
+        play_warning(forecast_tune);
+      }
+    }
+    else if (forecast < 0)
+      announced = -1;
+  }
+}
+
+// The LED is lit with each note of the warning
+void play_warning(const tune_t &tune)
+{
+  for (uint16_t i = 0; i < tune.n_notes; i++)
+  {
+    uint16_t note = tune.notes[i];
+    uint16_t hz = melody_note_hz(note);
+    if (hz != 0)
+      tone(Buzzer, hz);
+    else
+      noTone(Buzzer);
+    digitalWrite(LED, hz != 0 ? HIGH : LOW);
+    delay(melody_note_ms(note, tune.bpm));
   }
-  display2.display();
+  noTone(Buzzer);
+  digitalWrite(LED, LOW);
 }
 
-void spinner()
+// Single-character console commands: T = dump input trace, A = export adherence log,
+// L = alarm firing latency, C = climate sensors, trends and exposure, H = climate history, B = I2C bus time,
+// P = display power, E = event bus queues, D = health, X = previous crash, N = clock sync,
+// G = logging, S = boot profile, F = perf trace
+void poll_serial_commands()
 {
-  static int8_t counter = 0;
-  const char *glyphs = "\xa1\xa5\xdb";
-  display.setCursor(100, 40);
-  display.print(glyphs[counter++]);
-  if (counter == strlen(glyphs))
-    counter = 0;
-  display.display();
-}
\ No newline at end of file
+  while (Serial.available())
+  {
+    int c = Serial.read();
+    if (c == 'T')
+      trace_dump(console);
+    else if (c == 'F')
+      perf_trace_dump(console);
+    else if (c == 'A')
+      adherence_export(console);
+    else if (c == 'L')
+    {
+      const alarm_latency_t &l = alarm_latency();
+      console.printf("alarm latency fired=%lu late=%lu last=%ldms max=%ldms mean=%ldms\n",
+                    (unsigned long)l.fired, (unsigned long)l.late, (long)l.last_ms, (long)l.max_ms,
+                    (long)(l.fired ? l.total_ms / l.fired : 0));
+    }
+    else if (c == 'C')
+    {
+      if constexpr (feature_climate)
+        for (int i = 0; i < sensor_count(); i++)
+        {
+          const sensor_t &s = sensor(i);
+          const climate_sampler_stats_t &st = s.sampler.stats;
+          const sensor_anomaly_stats_t &an = s.anomaly.stats;
+          const climate_trend_t &tt = s.sampler.temp_trend, &ht = s.sampler.hum_trend;
+          console.printf("climate %s %s reads=%lu failed=%lu bursts=%lu interval=%lums fault=%s faults=%lu "
+                        "jumps=%lu shifts=%lu\n",
+                        s.name, s.present ? "ok" : "absent", (unsigned long)st.reads, (unsigned long)st.failed,
+                        (unsigned long)st.bursts, st.interval_ms, sensor_fault_name(s.anomaly.fault),
+                        (unsigned long)an.faults, (unsigned long)an.jumps, (unsigned long)an.shifts);
+          // Slopes per minute, +- one standard error
+          console.printf("trend %s temp=%.2f slope=%+.3f/min se=%.3f hum=%.1f slope=%+.2f/min se=%.2f\n", s.name,
+                        tt.level, tt.slope * 60, climate_trend_slope_se(tt) * 60, ht.level, ht.slope * 60,
+                        climate_trend_slope_se(ht) * 60);
+          for (int p = 0; p < EXPOSURE_PERIODS; p++)
+          {
+            const exposure_t &x = climate_exposure(i, (exposure_period_t)p);
+            console.printf("exposure %s %s since=%lu covered=%.0fs mkt=%.2f above=%.1fCmin below=%.1fCmin "
+                          "hum_above=%.1f%%min hum_below=%.1f%%min hum_mean=%.1f\n",
+                          s.name, exposure_period_name((exposure_period_t)p), (unsigned long)x.start, x.seconds,
+                          exposure_mkt(x), x.temp_above, x.temp_below, x.hum_above, x.hum_below,
+                          exposure_hum_mean(x));
+          }
+        }
+    }
+    else if (c == 'H')
+    {
+      if constexpr (feature_climate)
+        sensors_export_history(console);
+    }
+    else if (c == 'B')
+    {
+      for (int i = 0; i < 2; i++)
+      {
+        const bus_stats_t &b = bus_stats(i);
+        console.printf("i2c%d display=%lums sensor=%lums deferred display=%lu sensor=%lu max_pass=%luus\n", i,
+                      (unsigned long)(b.display_us / 1000), (unsigned long)(b.sensor_us / 1000),
+                      (unsigned long)b.display_deferred, (unsigned long)b.sensor_deferred,
+                      (unsigned long)b.max_pass_us);
+      }
+    }
+    else if (c == 'P')
+    {
+      static const char *state_names[] = {"on", "dimmed", "off"};
+      for (int i = 0; i < 2; i++)
+      {
+        panel_stats_t p = panel_stats(i);
+        console.printf("oled%d %s on=%lus flushes=%lu partial=%lu skipped=%lu bytes=%lu\n", i + 1, p.absent ? "absent" : state_names[p.state],
+                      p.on_ms / 1000, (unsigned long)p.flushes, (unsigned long)p.partial, (unsigned long)p.skipped,
+                      (unsigned long)p.bytes);
+      }
+    }
+    else if (c == 'D')
+      health_report(console);
+    else if (c == 'X')
+      crash_report(console);
+    else if (c == 'N')
+    {
+      if constexpr (feature_wifi_time)
+      {
+        const clock_sync_stats_t &n = clock_sync_stats();
+        console.printf("clock %s syncs=%lu failed=%lu steps=%lu offset=%ldus rtt=%luus drift=%.2fppm interval=%lumin wifi=%lus\n",
+                      n.synced ? "synced" : "unsynced", (unsigned long)n.syncs, (unsigned long)n.failed,
+                      (unsigned long)n.steps, (long)n.last_offset_us, (unsigned long)n.last_rtt_us, n.drift_ppm,
+                      n.interval_ms / 60000, n.radio_on_ms / 1000);
+      }
+    }
+    else if (c == 'S')
+      boot_report(console);
+    else if (c == 'G')
+    {
+      const log_stats_t &g = log_stats();
+      console.printf("log level=%d written=%lu dropped=%lu suppressed=%lu high_water=%u/%d\n", LOG_LEVEL,
+                    (unsigned long)g.written, (unsigned long)g.dropped, (unsigned long)g.suppressed, g.high_water,
+                    LOG_RING_SIZE);
+    }
+    else if (c == 'E')
+    {
+      static const char *producer_names[] = {"isr", "loop"};
+      for (int i = 0; i < event_subscriber_count(); i++)
+        for (int p = 0; p < EVENT_PRODUCERS; p++)
+        {
+          event_ring_stats_t r = event_stats(i, (event_producer_t)p);
+          if (r.published == 0)
+            continue;
+          console.printf("events %s<-%s published=%lu dropped=%lu high_water=%u/%d\n", event_subscriber_name(i),
+                        producer_names[p], (unsigned long)r.published, (unsigned long)r.dropped, r.high_water,
+                        EVENT_RING_SIZE);
+        }
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#include "melody.h"
+
+static constexpr auto scale = MELODY("Scale:d=4,o=4,b=120:c,d,e,f,g,a,b,c5");
+static constexpr auto chime = MELODY("Chime:d=4,o=5,b=100:e,c,d,g4,2p,g4,d,e,c");
+static constexpr auto reveille = MELODY("Reveille:d=8,o=5,b=160:g4,c,e,c,g4,c,e,c,g4,c,e,g,4e,4c");
+static constexpr auto beeps = MELODY("Beeps:d=8,o=6,b=120:c,p,c,p,c,4p");
+static constexpr auto warning = MELODY("Warning:d=4,o=5,b=120:c,p");
+static constexpr auto fault = MELODY("Fault:d=8,o=4,b=120:a,e,a,e,4p");
+static constexpr auto forecast = MELODY("Forecast:d=16,o=6,b=120:e,p,g");
+
+const tune_t tunes[] = {
+    TUNE("Scale", scale),
+    TUNE("Chime", chime),
+    TUNE("Reveille", reveille),
+    TUNE("Beeps", beeps)};
+const int n_tunes = sizeof(tunes) / sizeof(tunes[0]);
+
+const tune_t warning_tune = TUNE("Warning", warning);
+const tune_t fault_tune = TUNE("Fault", fault);
+const tune_t forecast_tune = TUNE("Forecast", forecast);
+
+// Octave 8, C to B; lower octaves are rounded shifts of it
+static const uint16_t octave8_hz[12] = {4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902};
+
+uint16_t melody_note_hz(uint16_t note)
+{
+  int semitone = note & 0x0F;
+  if (semitone == MELODY_PAUSE)
+    return 0;
+  int shift = 8 - ((note >> 4) & 0x07);
+  return (octave8_hz[semitone] + (1 << shift >> 1)) >> shift;
+}
+
+uint32_t melody_note_ms(uint16_t note, uint16_t bpm)
+{
+  uint32_t ms = 240000UL / bpm >> ((note >> 7) & 0x07); // a whole note is four beats
+  return note & (1 << 10) ? ms * 3 / 2 : ms;
+}
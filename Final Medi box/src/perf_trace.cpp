@@ -0,0 +1,171 @@
+#include "perf_trace.h"
+
+#include <atomic>
+#include <esp_timer.h>
+
+#ifdef MEDIBOX_HOST
+#include "host_env.h"
+
+#define HOST_CPU_MHZ 240
+#endif
+
+struct perf_event_t
+{
+  uint32_t cycles;
+  const char *name;
+  uint32_t arg;
+  uint8_t type;
+  uint8_t ctx;
+};
+
+static perf_event_t ring[PERF_TRACE_CAPACITY];
+static std::atomic<uint32_t> written(0);
+static volatile bool paused = false;
+static uint32_t skipped = 0;
+
+struct anchor_t
+{
+  uint32_t cycles;
+  int64_t us;
+};
+
+static anchor_t anchors[2]; // each core's latest, also when the ring has lost it
+static const char *stage = nullptr;
+
+#ifdef MEDIBOX_HOST
+
+static uint32_t cycle_count()
+{
+  return (uint32_t)(host_now_us() * HOST_CPU_MHZ);
+}
+
+static uint8_t context()
+{
+  return 1; // the loop task's core
+}
+
+static uint32_t cpu_mhz()
+{
+  return HOST_CPU_MHZ;
+}
+
+#else
+
+static inline uint32_t IRAM_ATTR cycle_count()
+{
+  return ESP.getCycleCount();
+}
+
+static inline uint8_t IRAM_ATTR context()
+{
+  return xPortGetCoreID() | (xPortInIsrContext() ? PERF_CTX_ISR : 0);
+}
+
+static uint32_t cpu_mhz()
+{
+  return getCpuFrequencyMhz();
+}
+
+#endif
+
+static inline void IRAM_ATTR push(uint8_t type, const char *name, uint32_t arg, uint32_t cycles, uint8_t ctx)
+{
+  uint32_t slot = written.fetch_add(1, std::memory_order_relaxed) & (PERF_TRACE_CAPACITY - 1);
+  ring[slot] = {cycles, name, arg, type, ctx};
+}
+
+static void IRAM_ATTR record(uint8_t type, const char *name, uint32_t arg)
+{
+  if (paused)
+  {
+    skipped++;
+    return;
+  }
+  uint32_t cycles = cycle_count();
+  uint8_t ctx = context();
+  uint8_t core = ctx & 1;
+  // The cycle counter wraps, so the age of the anchor is judged in
+  // esp_timer time; after a quiet spell of whole wraps the cycles alone
+  // would look recent
+  int64_t us = esp_timer_get_time();
+  if (us - anchors[core].us > PERF_ANCHOR_US || anchors[core].us == 0)
+  {
+    anchors[core] = {cycles, us};
+    push(PERF_ANCHOR, nullptr, (uint32_t)us, cycles, core);
+  }
+  push(type, name, arg, cycles, ctx);
+}
+
+void IRAM_ATTR perf_begin(const char *name, uint32_t arg)
+{
+  record(PERF_BEGIN, name, arg);
+}
+
+void IRAM_ATTR perf_end(const char *name, uint32_t arg)
+{
+  record(PERF_END, name, arg);
+}
+
+void IRAM_ATTR perf_instant(const char *name, uint32_t arg)
+{
+  record(PERF_INSTANT, name, arg);
+}
+
+void perf_stage(const char *name)
+{
+  if (stage != nullptr)
+    record(PERF_END, stage, 0);
+  stage = name;
+  if (name != nullptr)
+    record(PERF_BEGIN, name, 0);
+}
+
+void perf_trace_dump(Print &out)
+{
+  paused = true;
+  delayMicroseconds(10); // a record in flight on the other core finishes its store
+  uint32_t total = written.load();
+  uint32_t n = min(total, (uint32_t)PERF_TRACE_CAPACITY);
+  uint32_t start = total - n;
+
+  // Every event is within PERF_ANCHOR_US of its core's anchor before it.
+  // If the ring has lost that anchor but holds a later one, the event may
+  // be any number of cycle wraps older than the later one, so it is left
+  // out as untimed. A core with no anchor in the ring still has its
+  // latest one, which precedes all of its events there.
+  anchor_t anchor[2] = {anchors[0], anchors[1]};
+  bool found[2] = {false, false};
+  uint32_t before[2] = {0, 0};
+  for (uint32_t k = 0; k < n; k++)
+  {
+    const perf_event_t &e = ring[(start + k) & (PERF_TRACE_CAPACITY - 1)];
+    uint8_t core = e.ctx & 1;
+    if (e.type == PERF_ANCHOR)
+      found[core] = true;
+    else if (!found[core])
+      before[core]++;
+  }
+  bool timed[2] = {!found[0], !found[1]};
+  uint32_t untimed = (found[0] ? before[0] : 0) + (found[1] ? before[1] : 0);
+
+  int32_t mhz = cpu_mhz();
+  out.printf("# medibox-perf v1 events=%lu overwritten=%lu skipped=%lu untimed=%lu\n", (unsigned long)n,
+             (unsigned long)(total - n), (unsigned long)skipped, (unsigned long)untimed);
+  for (uint32_t k = 0; k < n; k++)
+  {
+    const perf_event_t &e = ring[(start + k) & (PERF_TRACE_CAPACITY - 1)];
+    uint8_t core = e.ctx & 1;
+    if (e.type == PERF_ANCHOR)
+    {
+      anchor[core] = {e.cycles, e.arg};
+      timed[core] = true;
+      continue;
+    }
+    if (!timed[core])
+      continue;
+    uint32_t t_us = (uint32_t)anchor[core].us + (int32_t)(e.cycles - anchor[core].cycles) / mhz;
+    out.printf("%c,%lu,%u,%lu,%s\n", e.type, (unsigned long)t_us, e.ctx, (unsigned long)e.arg, e.name);
+  }
+  out.println("# end");
+  paused = false;
+}
@@ -0,0 +1,73 @@
+#include "schedule.h"
+
+#define SECONDS_PER_DAY 86400
+
+dose_schedule_t schedule_daily(int hours, int minutes)
+{
+  return {SCHEDULE_WEEKLY, SCHEDULE_EVERY_DAY, (uint16_t)(hours * 60 + minutes), 0, 0, SCHEDULE_OPEN_END};
+}
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+  return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+int weekday_of_day(int32_t day)
+{
+  return (int)(((day % 7) + 7 + 4) % 7); // 1970-01-01 was a Thursday
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant's
+// days_from_civil), so no timegm() or TZ state is needed.
+int64_t local_seconds(int year, int month, int day, int hours, int minutes, int seconds)
+{
+  year -= month <= 2;
+  int64_t era = floor_div(year, 400);
+  int64_t yoe = year - era * 400;
+  int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = era * 146097 + doe - 719468;
+  return days * SECONDS_PER_DAY + hours * 3600 + minutes * 60 + seconds;
+}
+
+static int64_t next_weekly(const dose_schedule_t &s, int64_t now)
+{
+  if (!(s.days_mask & SCHEDULE_EVERY_DAY))
+    return SCHEDULE_NEVER;
+  int64_t day = floor_div(now, SECONDS_PER_DAY);
+  if (now - day * SECONDS_PER_DAY > s.start_minute * 60)
+    day++; // today's dose has passed
+  if (day < s.first_day)
+    day = s.first_day;
+  int wday = weekday_of_day((int32_t)day);
+  for (int i = 0; i < 7; i++, day++, wday = (wday + 1) % 7)
+  {
+    if (day > s.last_day)
+      return SCHEDULE_NEVER;
+    if (s.days_mask & (1 << wday))
+      return day * SECONDS_PER_DAY + s.start_minute * 60;
+  }
+  return SCHEDULE_NEVER;
+}
+
+static int64_t next_interval(const dose_schedule_t &s, int64_t now)
+{
+  if (s.interval_min == 0)
+    return SCHEDULE_NEVER;
+  int64_t anchor = (int64_t)s.first_day * SECONDS_PER_DAY + s.start_minute * 60;
+  int64_t period = s.interval_min * 60;
+  int64_t due = anchor;
+  if (now > anchor)
+    due = anchor + (now - anchor + period - 1) / period * period;
+  if (s.last_day != SCHEDULE_OPEN_END && due >= ((int64_t)s.last_day + 1) * SECONDS_PER_DAY)
+    return SCHEDULE_NEVER;
+  return due;
+}
+
+// Earliest dose at or after now
+int64_t schedule_next_due(const dose_schedule_t &s, int64_t now)
+{
+  if (s.kind == SCHEDULE_INTERVAL)
+    return next_interval(s, now);
+  return next_weekly(s, now);
+}
@@ -0,0 +1,148 @@
+#include "sensor_anomaly.h"
+
+// What a compartment can physically do: a step is impossible beyond
+// max_step plus max_rate for every second since the last good reading.
+// Steps are never taken as spread less than min_sd (the sensors' noise).
+struct channel_limits_t
+{
+  float max_rate; // units per second
+  float max_step;
+  float min_sd;
+};
+
+static const channel_limits_t temp_limits = {0.1f, 2, 0.2f};
+static const channel_limits_t hum_limits = {1, 10, 1};
+
+void sensor_anomaly_init(sensor_anomaly_t &a)
+{
+  a = {};
+}
+
+static bool impossible(const anomaly_channel_t &c, const channel_limits_t &l, float value, float dt)
+{
+  return fabsf(value - c.last) > l.max_step + l.max_rate * dt;
+}
+
+// Takes one good reading; true when the CUSUM decides the changes have
+// grown. A change is how much this step differs from the one before, so a
+// steady trend, like a compartment warming after its door was opened, is
+// not one.
+static bool learn(anomaly_channel_t &c, const channel_limits_t &l, uint8_t steps, float value)
+{
+  float step = value - c.last;
+  float change = step - c.step;
+  c.last = value;
+  c.step = step;
+  bool shifted = false;
+  if (steps >= ANOMALY_MIN_STEPS)
+  {
+    float var = max(c.change_m2 / (steps - 1), l.min_sd * l.min_sd);
+    float d = change - c.change_mean;
+    float z2 = d * d / var;
+    c.cusum = max(0.0f, c.cusum + min(z2, ANOMALY_CUSUM_CAP) - ANOMALY_CUSUM_K);
+    if (c.cusum > ANOMALY_CUSUM_H)
+    {
+      c.cusum = ANOMALY_CUSUM_H / 2; // still wild soon alarms again, quiet decays
+      shifted = true;
+    }
+    if (z2 > ANOMALY_CUSUM_CAP)
+      return shifted; // an outlier would teach the statistics that wild is normal
+  }
+
+  // Welford; once the window is full, the oldest share of m2 is forgotten
+  // so the mean and variance follow the recent changes
+  uint8_t n = steps < ANOMALY_WINDOW ? steps + 1 : ANOMALY_WINDOW;
+  if (steps == ANOMALY_WINDOW)
+    c.change_m2 -= c.change_m2 / ANOMALY_WINDOW;
+  float d = change - c.change_mean;
+  c.change_mean += d / n;
+  c.change_m2 += d * (change - c.change_mean);
+  return shifted;
+}
+
+static uint8_t failed_reads(const sensor_anomaly_t &a)
+{
+  return __builtin_popcount(a.failures);
+}
+
+bool sensor_anomaly_update(sensor_anomaly_t &a, float temp, float hum, unsigned long now_ms)
+{
+  bool failed = isnan(temp) || isnan(hum);
+  a.failures = (uint16_t)(a.failures << 1 | (failed ? 1 : 0));
+
+  uint8_t found = SENSOR_FAULT_NONE;
+  if (!failed)
+  {
+    if (!a.have_last)
+    {
+      a.temp.last = temp;
+      a.hum.last = hum;
+      a.have_last = true;
+      a.last_ms = a.same_since_ms = now_ms;
+    }
+    else
+    {
+      float dt = (now_ms - a.last_ms) / 1000.0f;
+      if (impossible(a.temp, temp_limits, temp, dt) || impossible(a.hum, hum_limits, hum, dt))
+      {
+        a.stats.jumps++;
+        found = SENSOR_FAULT_JUMP;
+      }
+      else
+      {
+        if (temp == a.temp.last && hum == a.hum.last)
+          a.same++;
+        else
+        {
+          a.same = 0;
+          a.same_since_ms = now_ms;
+        }
+        bool shifted = learn(a.temp, temp_limits, a.steps, temp);
+        shifted |= learn(a.hum, hum_limits, a.steps, hum);
+        if (a.steps < ANOMALY_WINDOW)
+          a.steps++;
+        a.last_ms = now_ms;
+        if (shifted)
+        {
+          a.stats.shifts++;
+          found = SENSOR_FAULT_ERRATIC;
+        }
+        if (a.same >= ANOMALY_STUCK_READS && now_ms - a.same_since_ms >= ANOMALY_STUCK_MS)
+          found = SENSOR_FAULT_STUCK;
+      }
+    }
+  }
+  if (failed_reads(a) >= ANOMALY_MAX_FAILED)
+    found = SENSOR_FAULT_FAILING;
+
+  uint8_t was = a.fault;
+  if (found != SENSOR_FAULT_NONE)
+  {
+    a.clean = 0;
+    if (found > a.fault)
+      a.fault = found;
+  }
+  else if (!failed && a.fault != SENSOR_FAULT_NONE && ++a.clean >= ANOMALY_CLEAR_READS)
+    a.fault = SENSOR_FAULT_NONE;
+  if (a.fault != SENSOR_FAULT_NONE && was == SENSOR_FAULT_NONE)
+    a.stats.faults++;
+  return a.fault != was;
+}
+
+const char *sensor_fault_name(uint8_t fault)
+{
+  switch (fault)
+  {
+  case SENSOR_FAULT_NONE:
+    return "none";
+  case SENSOR_FAULT_ERRATIC:
+    return "erratic";
+  case SENSOR_FAULT_JUMP:
+    return "jump";
+  case SENSOR_FAULT_STUCK:
+    return "stuck";
+  case SENSOR_FAULT_FAILING:
+    return "failing";
+  }
+  return "?";
+}
@@ -0,0 +1,369 @@
+#include "sensors.h"
+
+#include "dht_rmt.h"
+#include "events.h"
+#include "i2c_bus.h"
+#include "input_trace.h"
+#include "log.h"
+#include "perf_trace.h"
+
+#define SHT3X_MEASURE_MSB 0x24 // single shot, high repeatability, no clock stretching
+#define SHT3X_MEASURE_LSB 0x00
+#define SHT3X_CONVERSION_MS 16
+
+#define BME280_CHIP_ID 0x60
+#define BME280_REG_ID 0xD0
+#define BME280_REG_CALIB_T 0x88
+#define BME280_REG_CALIB_H1 0xA1
+#define BME280_REG_CALIB_H2 0xE1
+#define BME280_REG_CTRL_HUM 0xF2
+#define BME280_REG_CTRL_MEAS 0xF4
+#define BME280_REG_DATA 0xF7
+#define BME280_CTRL_HUM_X1 0x01
+#define BME280_CTRL_MEAS_FORCED 0x25 // temperature and pressure x1, forced mode
+#define BME280_CONVERSION_MS 10
+
+enum sensor_phase_t : uint8_t
+{
+  PHASE_IDLE,
+  PHASE_CONVERTING
+};
+
+enum sensor_result_t : uint8_t
+{
+  RESULT_BUSY,
+  RESULT_OK,
+  RESULT_FAILED
+};
+
+struct sensor_driver_t
+{
+  bool (*begin)(sensor_t &s);
+  sensor_result_t (*start)(sensor_t &s); // RESULT_BUSY: try again next pass
+  sensor_result_t (*read)(sensor_t &s, float *temp, float *hum);
+  unsigned long conversion_ms;
+};
+
+static sensor_t sensors[SENSOR_MAX];
+static int n_sensors = 0;
+static DhtRmt dht; // RMT channel 0, so at most one DHT22
+
+// I2C helpers; every transaction is charged to the sensor's bus
+
+static bool i2c_write(sensor_t &s, const uint8_t *data, size_t n)
+{
+  unsigned long t0 = micros();
+  s.wire->beginTransmission(s.addr);
+  s.wire->write(data, n);
+  bool ok = s.wire->endTransmission() == 0;
+  bus_charge(s.wire, BUS_SENSOR, micros() - t0);
+  return ok;
+}
+
+static bool i2c_read(sensor_t &s, uint8_t *out, size_t n)
+{
+  unsigned long t0 = micros();
+  bool ok = s.wire->requestFrom(s.addr, (uint8_t)n) == n;
+  for (size_t i = 0; ok && i < n; i++)
+    out[i] = s.wire->read();
+  bus_charge(s.wire, BUS_SENSOR, micros() - t0);
+  return ok;
+}
+
+static bool i2c_read_reg(sensor_t &s, uint8_t reg, uint8_t *out, size_t n)
+{
+  unsigned long t0 = micros();
+  s.wire->beginTransmission(s.addr);
+  s.wire->write(reg);
+  bool ok = s.wire->endTransmission(false) == 0; // repeated start
+  bus_charge(s.wire, BUS_SENSOR, micros() - t0);
+  return ok && i2c_read(s, out, n);
+}
+
+// DHT22: the RMT driver does the whole transaction in the background
+
+static bool dht22_begin(sensor_t &s)
+{
+  return dht.setup(s.pin, DhtRmt::DHT22);
+}
+
+static sensor_result_t dht22_start(sensor_t &s)
+{
+  return dht.request() ? RESULT_OK : RESULT_BUSY;
+}
+
+static sensor_result_t dht22_read(sensor_t &s, float *temp, float *hum)
+{
+  if (!dht.available())
+    return RESULT_BUSY;
+  dht_reading_t r = dht.lastReading();
+  *temp = r.temperature;
+  *hum = r.humidity;
+  return r.ok ? RESULT_OK : RESULT_FAILED;
+}
+
+// SHT3x: each 16-bit word is followed by a CRC-8 (poly 0x31, init 0xFF)
+
+static uint8_t sht3x_crc(const uint8_t *data)
+{
+  uint8_t crc = 0xFF;
+  for (int i = 0; i < 2; i++)
+  {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+static sensor_result_t sht3x_start(sensor_t &s)
+{
+  const uint8_t cmd[] = {SHT3X_MEASURE_MSB, SHT3X_MEASURE_LSB};
+  return i2c_write(s, cmd, sizeof(cmd)) ? RESULT_OK : RESULT_FAILED;
+}
+
+static bool sht3x_begin(sensor_t &s)
+{
+  return sht3x_start(s) == RESULT_OK; // probe; that result is never fetched
+}
+
+static sensor_result_t sht3x_read(sensor_t &s, float *temp, float *hum)
+{
+  uint8_t d[6];
+  if (!i2c_read(s, d, sizeof(d)) || sht3x_crc(d) != d[2] || sht3x_crc(d + 3) != d[5])
+    return RESULT_FAILED;
+  *temp = -45 + 175 * ((d[0] << 8) | d[1]) / 65535.0f;
+  *hum = 100 * ((d[3] << 8) | d[4]) / 65535.0f;
+  return RESULT_OK;
+}
+
+// BME280 in forced mode; compensation as in the Bosch datasheet (int32)
+
+static bool bme280_begin(sensor_t &s)
+{
+  uint8_t id, t[6], h1, h[7];
+  if (!i2c_read_reg(s, BME280_REG_ID, &id, 1) || id != BME280_CHIP_ID)
+    return false;
+  if (!i2c_read_reg(s, BME280_REG_CALIB_T, t, sizeof(t)) || !i2c_read_reg(s, BME280_REG_CALIB_H1, &h1, 1) ||
+      !i2c_read_reg(s, BME280_REG_CALIB_H2, h, sizeof(h)))
+    return false;
+  bme280_calib_t &c = s.calib;
+  c.t1 = t[0] | (t[1] << 8);
+  c.t2 = (int16_t)(t[2] | (t[3] << 8));
+  c.t3 = (int16_t)(t[4] | (t[5] << 8));
+  c.h1 = h1;
+  c.h2 = (int16_t)(h[0] | (h[1] << 8));
+  c.h3 = h[2];
+  c.h4 = (int16_t)((int8_t)h[3] * 16 | (h[4] & 0x0F));
+  c.h5 = (int16_t)((int8_t)h[5] * 16 | (h[4] >> 4));
+  c.h6 = (int8_t)h[6];
+  return true;
+}
+
+static sensor_result_t bme280_start(sensor_t &s)
+{
+  // ctrl_hum only takes effect with the following ctrl_meas write
+  const uint8_t cmd[] = {BME280_REG_CTRL_HUM, BME280_CTRL_HUM_X1, BME280_REG_CTRL_MEAS, BME280_CTRL_MEAS_FORCED};
+  return i2c_write(s, cmd, sizeof(cmd)) ? RESULT_OK : RESULT_FAILED;
+}
+
+static sensor_result_t bme280_read(sensor_t &s, float *temp, float *hum)
+{
+  uint8_t d[8];
+  if (!i2c_read_reg(s, BME280_REG_DATA, d, sizeof(d)))
+    return RESULT_FAILED;
+  const bme280_calib_t &c = s.calib;
+  int32_t adc_t = ((int32_t)d[3] << 12) | (d[4] << 4) | (d[5] >> 4);
+  int32_t adc_h = (d[6] << 8) | d[7];
+
+  int32_t var1 = ((((adc_t >> 3) - ((int32_t)c.t1 << 1))) * c.t2) >> 11;
+  int32_t var2 = (((((adc_t >> 4) - c.t1) * ((adc_t >> 4) - c.t1)) >> 12) * c.t3) >> 14;
+  int32_t t_fine = var1 + var2;
+  *temp = ((t_fine * 5 + 128) >> 8) / 100.0f;
+
+  int32_t v = t_fine - 76800;
+  v = (((((adc_h << 14) - (int32_t)c.h4 * 1048576 - (c.h5 * v)) + 16384) >> 15) *
+       (((((((v * c.h6) >> 10) * (((v * c.h3) >> 11) + 32768)) >> 10) + 2097152) * c.h2 + 8192) >> 14));
+  v = v - (((((v >> 15) * (v >> 15)) >> 7) * c.h1) >> 4);
+  v = constrain(v, 0, 419430400);
+  *hum = (v >> 12) / 1024.0f;
+  return RESULT_OK;
+}
+
+static const sensor_driver_t drivers[] = {
+    {dht22_begin, dht22_start, dht22_read, 0},                        // SENSOR_DHT22
+    {sht3x_begin, sht3x_start, sht3x_read, SHT3X_CONVERSION_MS},      // SENSOR_SHT3X
+    {bme280_begin, bme280_start, bme280_read, BME280_CONVERSION_MS}}; // SENSOR_BME280
+
+static int add(const char *name, uint8_t kind, const climate_limits_t &limits)
+{
+  if (n_sensors == SENSOR_MAX)
+    return -1;
+  sensor_t &s = sensors[n_sensors];
+  s = {};
+  s.name = name;
+  s.kind = kind;
+  s.temp = s.hum = NAN;
+  climate_sampler_init(s.sampler, limits);
+  sensor_anomaly_init(s.anomaly);
+  return n_sensors++;
+}
+
+int sensor_add_dht22(const char *name, uint8_t pin, const climate_limits_t &limits)
+{
+  for (int i = 0; i < n_sensors; i++)
+    if (sensors[i].kind == SENSOR_DHT22)
+      return -1;
+  int idx = add(name, SENSOR_DHT22, limits);
+  if (idx >= 0)
+    sensors[idx].pin = pin;
+  return idx;
+}
+
+int sensor_add_sht3x(const char *name, TwoWire *wire, uint8_t addr, const climate_limits_t &limits)
+{
+  int idx = add(name, SENSOR_SHT3X, limits);
+  if (idx >= 0)
+  {
+    sensors[idx].wire = wire;
+    sensors[idx].addr = addr;
+  }
+  return idx;
+}
+
+int sensor_add_bme280(const char *name, TwoWire *wire, uint8_t addr, const climate_limits_t &limits)
+{
+  int idx = add(name, SENSOR_BME280, limits);
+  if (idx >= 0)
+  {
+    sensors[idx].wire = wire;
+    sensors[idx].addr = addr;
+  }
+  return idx;
+}
+
+void sensors_begin(TwoWire *wire)
+{
+  for (int i = 0; i < n_sensors; i++)
+  {
+    sensor_t &s = sensors[i];
+    if (s.wire != wire)
+      continue;
+    s.present = drivers[s.kind].begin(s);
+    LOG_EVERY(0, LOG_LEVEL_INFO, "Sensor %s: %s", s.name, s.present ? "ok" : "not found"); // one per sensor
+  }
+}
+
+static void complete(int idx, float temp, float hum)
+{
+  sensor_t &s = sensors[idx];
+  unsigned long now = millis();
+  s.temp = temp;
+  s.hum = hum;
+  s.read_ms = now;
+  s.phase = PHASE_IDLE;
+  if (isnan(temp))
+    LOG_W("Sensor %s read failed", s.name);
+  trace_record_climate(idx, temp, hum);
+  climate_sampler_update(s.sampler, temp, hum, now);
+  if (sensor_anomaly_update(s.anomaly, temp, hum, now))
+  {
+    if (s.anomaly.fault != SENSOR_FAULT_NONE)
+      LOG_W("Sensor %s fault: %s", s.name, sensor_fault_name(s.anomaly.fault));
+    else
+      LOG_I("Sensor %s fault cleared", s.name);
+  }
+
+  sensor_sample_t &h = s.history[s.history_head];
+  bool failed = isnan(temp) || isnan(hum);
+  h.t_ms = now;
+  h.temp_x10 = failed ? SENSOR_NO_VALUE : (int16_t)lroundf(temp * 10);
+  h.hum_x10 = failed ? SENSOR_NO_VALUE : (int16_t)lroundf(hum * 10);
+  s.history_head = (s.history_head + 1) % SENSOR_HISTORY;
+  if (s.history_count < SENSOR_HISTORY)
+    s.history_count++;
+  event_publish_reading(PRODUCER_LOOP, EVENT_SAMPLE, idx, temp, hum);
+}
+
+// One step of every sensor's start / convert / read cycle
+void sensors_poll()
+{
+  unsigned long now = millis();
+  for (int i = 0; i < n_sensors; i++)
+  {
+    sensor_t &s = sensors[i];
+    const sensor_driver_t &drv = drivers[s.kind];
+    if (!s.present)
+      continue;
+    if (s.phase == PHASE_IDLE)
+    {
+      if (!climate_sampler_due(s.sampler, now))
+        continue;
+      if (s.wire != nullptr && !bus_available(s.wire, BUS_SENSOR))
+        continue;
+      perf_begin("sensor start", i);
+      sensor_result_t r = drv.start(s);
+      perf_end("sensor start", i);
+      if (r == RESULT_FAILED)
+        complete(i, NAN, NAN);
+      else if (r == RESULT_OK)
+      {
+        s.phase = PHASE_CONVERTING;
+        s.phase_due_ms = now + drv.conversion_ms;
+      }
+    }
+    else if ((long)(now - s.phase_due_ms) >= 0)
+    {
+      if (s.wire != nullptr && !bus_available(s.wire, BUS_SENSOR))
+        continue;
+      float temp, hum;
+      perf_begin("sensor read", i);
+      sensor_result_t r = drv.read(s, &temp, &hum);
+      perf_end("sensor read", i);
+      if (r == RESULT_OK)
+        complete(i, temp, hum);
+      else if (r == RESULT_FAILED)
+        complete(i, NAN, NAN);
+    }
+  }
+}
+
+int sensor_count()
+{
+  return n_sensors;
+}
+
+const sensor_t &sensor(int idx)
+{
+  return sensors[idx];
+}
+
+bool sensor_in_range(const sensor_t &s)
+{
+  return climate_in_range(s.sampler.limits, s.temp, s.hum);
+}
+
+bool sensor_faulty(const sensor_t &s)
+{
+  return s.anomaly.fault != SENSOR_FAULT_NONE;
+}
+
+// CSV, oldest first: sensor,t_ms,temp,hum (empty fields for failed reads)
+void sensors_export_history(Print &out)
+{
+  out.println("# medibox-climate v1");
+  for (int i = 0; i < n_sensors; i++)
+  {
+    const sensor_t &s = sensors[i];
+    int start = (s.history_head + SENSOR_HISTORY - s.history_count) % SENSOR_HISTORY;
+    for (int k = 0; k < s.history_count; k++)
+    {
+      const sensor_sample_t &h = s.history[(start + k) % SENSOR_HISTORY];
+      if (h.temp_x10 == SENSOR_NO_VALUE)
+        out.printf("%s,%lu,,\n", s.name, (unsigned long)h.t_ms);
+      else
+        out.printf("%s,%lu,%.1f,%.1f\n", s.name, (unsigned long)h.t_ms, h.temp_x10 / 10.0f, h.hum_x10 / 10.0f);
+    }
+  }
+  out.println("# end");
+}
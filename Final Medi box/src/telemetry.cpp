@@ -0,0 +1,277 @@
+#include "telemetry.h"
+
+#include <esp_system.h>
+#include "climate_exposure.h"
+#include "clock_sync.h"
+#include "crash.h"
+#include "events.h"
+#include "build_features.h"
+#include "health.h"
+#include "i2c_bus.h"
+#include "sensors.h"
+
+#ifndef MEDIBOX_HOST
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#endif
+
+enum send_mode_t : uint8_t
+{
+  SEND_WAIT, // console text: wait for the UART
+  SEND_DROP, // data: drop and count if the UART is full
+  SEND_TRY   // log: leave it to the caller to retry
+};
+
+static int events = -1;
+static uint16_t seq = 0;
+static telemetry_stats_t stats = {0, 0, 0};
+static unsigned long last_metrics_ms = 0;
+
+// The log task sends too, and a frame must go out whole with its own seq
+#ifndef MEDIBOX_HOST
+static SemaphoreHandle_t send_lock = nullptr;
+
+static void lock()
+{
+  xSemaphoreTake(send_lock, portMAX_DELAY);
+}
+
+static void unlock()
+{
+  xSemaphoreGive(send_lock);
+}
+#else
+static void lock() {}
+static void unlock() {}
+#endif
+
+// Header, body and CRC, then COBS and the delimiter. Returns false if the
+// frame did not fit in the UART buffer and was not sent.
+static bool send(uint8_t type, const uint8_t *body, size_t n, send_mode_t mode)
+{
+  uint8_t record[TLM_MAX_RECORD];
+  uint8_t frame[TLM_MAX_FRAME];
+  lock();
+  if (mode == SEND_TRY && Serial.availableForWrite() < TLM_MAX_FRAME)
+  {
+    unlock();
+    return false;
+  }
+  record[0] = type;
+  tlm_put_u16(record + 1, seq++);
+  tlm_put_u32(record + 3, millis());
+  memcpy(record + TLM_HEADER_BYTES, body, n);
+  size_t len = TLM_HEADER_BYTES + n;
+  tlm_put_u16(record + len, tlm_crc16(record, len));
+  len += TLM_CRC_BYTES;
+  size_t framed = tlm_cobs_encode(record, len, frame);
+  frame[framed++] = 0;
+
+  if (mode == SEND_DROP && Serial.availableForWrite() < (int)framed)
+  {
+    stats.dropped++;
+    unlock();
+    return false;
+  }
+  Serial.write(frame, framed);
+  stats.frames++;
+  stats.bytes += framed;
+  unlock();
+  return true;
+}
+
+// Console lines as TLM_TEXT frames; long lines are split
+class TelemetryConsole : public Print
+{
+public:
+  size_t write(uint8_t c) override
+  {
+    if (c == '\n')
+      flush_line();
+    else if (c != '\r')
+    {
+      line_[len_++] = c;
+      if (len_ == TLM_MAX_BODY)
+        flush_line();
+    }
+    return 1;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    for (size_t i = 0; i < size; i++)
+      write(buffer[i]);
+    return size;
+  }
+
+private:
+  void flush_line()
+  {
+    send(TLM_TEXT, line_, len_, SEND_WAIT);
+    len_ = 0;
+  }
+
+  uint8_t line_[TLM_MAX_BODY];
+  size_t len_ = 0;
+};
+
+static TelemetryConsole console_impl;
+Print &console = console_impl;
+
+void telemetry_begin()
+{
+#ifndef MEDIBOX_HOST
+  send_lock = xSemaphoreCreateMutex();
+#endif
+  Serial.setTxBufferSize(TELEMETRY_TX_BUFFER);
+  Serial.begin(TELEMETRY_BAUD);
+  events = event_subscribe("telemetry", EVENT_MASK(EVENT_SAMPLE) | EVENT_MASK(EVENT_ALARM) | EVENT_MASK(EVENT_DOSE) |
+                                            EVENT_MASK(EVENT_CONFIG) | EVENT_MASK(EVENT_CLOCK));
+  last_metrics_ms = millis();
+}
+
+static int16_t x100(float v)
+{
+  return isnan(v) ? TLM_NO_VALUE : (int16_t)constrain(lroundf(v * 100), (long)INT16_MIN + 1, (long)INT16_MAX);
+}
+
+static void send_event(const event_t &e)
+{
+  uint8_t body[16];
+  switch (e.type)
+  {
+  case EVENT_SAMPLE:
+    body[0] = e.arg;
+    tlm_put_u16(body + 1, (uint16_t)x100(e.reading[0]));
+    tlm_put_u16(body + 3, (uint16_t)x100(e.reading[1]));
+    send(TLM_SAMPLE, body, 5, SEND_DROP);
+    return;
+  case EVENT_ALARM:
+    body[0] = e.arg;
+    tlm_put_u32(body + 1, (uint32_t)e.value[0]);
+    send(TLM_ALARM, body, 5, SEND_DROP);
+    return;
+  case EVENT_DOSE:
+    body[0] = e.arg;
+    body[1] = (uint8_t)e.extra;
+    tlm_put_u32(body + 2, (uint32_t)e.value[0]);
+    tlm_put_u32(body + 6, (uint32_t)e.value[1]);
+    send(TLM_DOSE, body, 10, SEND_DROP);
+    return;
+  case EVENT_CONFIG:
+    body[0] = e.arg;
+    tlm_put_u32(body + 1, (uint32_t)e.value[0]);
+    tlm_put_u32(body + 5, (uint32_t)e.value[1]);
+    send(TLM_CONFIG, body, 9, SEND_DROP);
+    return;
+  case EVENT_CLOCK:
+    tlm_put_u32(body, (uint32_t)e.value[0]);
+    send(TLM_CLOCK, body, 4, SEND_DROP);
+    return;
+  }
+}
+
+static void send_metrics()
+{
+  const health_stats_t &h = health_stats();
+  tlm_metrics_t m = {};
+  m.uptime_s = millis() / 1000;
+  m.free_heap = h.free_heap;
+  m.largest_block = h.largest_block;
+  m.max_loop_gap_ms = h.max_feed_gap_ms;
+  for (int i = 0; i < event_subscriber_count(); i++)
+    for (int p = 0; p < EVENT_PRODUCERS; p++)
+      m.events_dropped += event_stats(i, (event_producer_t)p).dropped;
+  for (int i = 0; i < 2; i++)
+    m.bus_deferred += bus_stats(i).display_deferred + bus_stats(i).sensor_deferred;
+  if constexpr (feature_wifi_time)
+  {
+    const clock_sync_stats_t &c = clock_sync_stats();
+    m.clock_offset_us = c.last_offset_us;
+    m.drift_ppm_x100 = (int16_t)lroundf(c.drift_ppm * 100);
+  }
+  m.frames_dropped = stats.dropped;
+  uint8_t body[TLM_METRICS_BYTES];
+  tlm_pack_metrics(m, body);
+  send(TLM_METRICS, body, sizeof(body), SEND_DROP);
+}
+
+// Repeated with every metrics record, so a host that attaches after the
+// boot still learns why the device restarted
+static void send_crash()
+{
+  tlm_crash_t c = {};
+  c.reset_reason = esp_reset_reason();
+  crash_context_t last;
+  if (crash_last(&last))
+  {
+    c.cause = last.cause;
+    c.backtrace_depth = last.backtrace_depth;
+    c.uptime_ms = last.uptime_ms;
+    c.exc_cause = last.exc_cause;
+    c.exc_vaddr = last.exc_vaddr;
+    for (int i = 0; i < TLM_CRASH_BACKTRACE && i < last.backtrace_depth; i++)
+      c.backtrace[i] = last.backtrace[i];
+  }
+  uint8_t body[TLM_CRASH_BYTES];
+  tlm_pack_crash(c, body);
+  send(TLM_CRASH, body, sizeof(body), SEND_DROP);
+}
+
+static uint32_t tenths(double v)
+{
+  return (uint32_t)llround(min(v * 10, (double)UINT32_MAX));
+}
+
+static int16_t hundredths(float v)
+{
+  return isnan(v) ? TLM_NO_VALUE : (int16_t)lroundf(v * 100);
+}
+
+static void send_exposure()
+{
+  if constexpr (feature_climate)
+    for (int i = 0; i < sensor_count(); i++)
+    {
+      if (!sensor(i).present)
+        continue;
+      for (int p = 0; p < EXPOSURE_PERIODS; p++)
+      {
+        const exposure_t &e = climate_exposure(i, (exposure_period_t)p);
+        tlm_exposure_t x = {(uint8_t)i, (uint8_t)p, (uint32_t)e.seconds, hundredths(exposure_mkt(e)),
+                            tenths(e.temp_above), tenths(e.temp_below), tenths(e.hum_above), tenths(e.hum_below),
+                            hundredths(exposure_hum_mean(e))};
+        uint8_t body[TLM_EXPOSURE_BYTES];
+        tlm_pack_exposure(x, body);
+        send(TLM_EXPOSURE, body, sizeof(body), SEND_DROP);
+      }
+    }
+}
+
+void telemetry_update()
+{
+  event_t e;
+  while (event_poll(events, &e))
+    send_event(e);
+  if (millis() - last_metrics_ms >= TELEMETRY_METRICS_MS)
+  {
+    last_metrics_ms = millis();
+    send_metrics();
+    send_exposure();
+    send_crash();
+  }
+}
+
+bool telemetry_log(uint8_t level, const char *text, size_t n)
+{
+  uint8_t body[TLM_MAX_BODY];
+  n = min(n, (size_t)TLM_MAX_BODY - 1);
+  body[0] = level;
+  memcpy(body + 1, text, n);
+  return send(TLM_LOG, body, n + 1, SEND_TRY);
+}
+
+const telemetry_stats_t &telemetry_stats()
+{
+  return stats;
+}
@@ -0,0 +1,166 @@
+#include "telemetry_frame.h"
+
+uint16_t tlm_crc16(const uint8_t *data, size_t n)
+{
+  uint16_t crc = 0xFFFF;
+  while (n--)
+  {
+    crc ^= (uint16_t)*data++ << 8;
+    for (int k = 0; k < 8; k++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Each zero is replaced by the distance to the next one; a code byte of
+// 0xFF starts a run of 254 non-zero bytes with no zero after it
+size_t tlm_cobs_encode(const uint8_t *in, size_t n, uint8_t *out)
+{
+  size_t code_at = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (in[i] != 0)
+    {
+      out[o++] = in[i];
+      code++;
+    }
+    if (in[i] == 0 || code == 0xFF)
+    {
+      out[code_at] = code;
+      code_at = o++;
+      code = 1;
+    }
+  }
+  out[code_at] = code;
+  return o;
+}
+
+size_t tlm_cobs_decode(const uint8_t *in, size_t n, uint8_t *out)
+{
+  size_t i = 0, o = 0;
+  while (i < n)
+  {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > n)
+      return 0;
+    for (int k = 1; k < code; k++)
+    {
+      if (in[i] == 0)
+        return 0;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < n)
+      out[o++] = 0;
+  }
+  return o;
+}
+
+void tlm_put_u16(uint8_t *p, uint16_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+void tlm_put_u32(uint8_t *p, uint32_t v)
+{
+  tlm_put_u16(p, v);
+  tlm_put_u16(p + 2, v >> 16);
+}
+
+void tlm_put_u64(uint8_t *p, uint64_t v)
+{
+  tlm_put_u32(p, v);
+  tlm_put_u32(p + 4, v >> 32);
+}
+
+uint16_t tlm_get_u16(const uint8_t *p)
+{
+  return p[0] | (uint16_t)p[1] << 8;
+}
+
+uint32_t tlm_get_u32(const uint8_t *p)
+{
+  return tlm_get_u16(p) | (uint32_t)tlm_get_u16(p + 2) << 16;
+}
+
+uint64_t tlm_get_u64(const uint8_t *p)
+{
+  return tlm_get_u32(p) | (uint64_t)tlm_get_u32(p + 4) << 32;
+}
+
+void tlm_pack_metrics(const tlm_metrics_t &m, uint8_t *body)
+{
+  tlm_put_u32(body, m.uptime_s);
+  tlm_put_u32(body + 4, m.free_heap);
+  tlm_put_u32(body + 8, m.largest_block);
+  tlm_put_u32(body + 12, m.max_loop_gap_ms);
+  tlm_put_u32(body + 16, m.events_dropped);
+  tlm_put_u32(body + 20, m.bus_deferred);
+  tlm_put_u32(body + 24, (uint32_t)m.clock_offset_us);
+  tlm_put_u16(body + 28, (uint16_t)m.drift_ppm_x100);
+  tlm_put_u32(body + 30, m.frames_dropped);
+}
+
+void tlm_unpack_metrics(const uint8_t *body, tlm_metrics_t &m)
+{
+  m.uptime_s = tlm_get_u32(body);
+  m.free_heap = tlm_get_u32(body + 4);
+  m.largest_block = tlm_get_u32(body + 8);
+  m.max_loop_gap_ms = tlm_get_u32(body + 12);
+  m.events_dropped = tlm_get_u32(body + 16);
+  m.bus_deferred = tlm_get_u32(body + 20);
+  m.clock_offset_us = (int32_t)tlm_get_u32(body + 24);
+  m.drift_ppm_x100 = (int16_t)tlm_get_u16(body + 28);
+  m.frames_dropped = tlm_get_u32(body + 30);
+}
+
+void tlm_pack_exposure(const tlm_exposure_t &x, uint8_t *body)
+{
+  body[0] = x.sensor;
+  body[1] = x.period;
+  tlm_put_u32(body + 2, x.seconds);
+  tlm_put_u16(body + 6, (uint16_t)x.mkt_x100);
+  tlm_put_u32(body + 8, x.temp_above_x10);
+  tlm_put_u32(body + 12, x.temp_below_x10);
+  tlm_put_u32(body + 16, x.hum_above_x10);
+  tlm_put_u32(body + 20, x.hum_below_x10);
+  tlm_put_u16(body + 24, (uint16_t)x.hum_mean_x100);
+}
+
+void tlm_unpack_exposure(const uint8_t *body, tlm_exposure_t &x)
+{
+  x.sensor = body[0];
+  x.period = body[1];
+  x.seconds = tlm_get_u32(body + 2);
+  x.mkt_x100 = (int16_t)tlm_get_u16(body + 6);
+  x.temp_above_x10 = tlm_get_u32(body + 8);
+  x.temp_below_x10 = tlm_get_u32(body + 12);
+  x.hum_above_x10 = tlm_get_u32(body + 16);
+  x.hum_below_x10 = tlm_get_u32(body + 20);
+  x.hum_mean_x100 = (int16_t)tlm_get_u16(body + 24);
+}
+
+void tlm_pack_crash(const tlm_crash_t &c, uint8_t *body)
+{
+  body[0] = c.reset_reason;
+  body[1] = c.cause;
+  body[2] = c.backtrace_depth;
+  tlm_put_u32(body + 3, c.uptime_ms);
+  tlm_put_u32(body + 7, c.exc_cause);
+  tlm_put_u32(body + 11, c.exc_vaddr);
+  for (int i = 0; i < TLM_CRASH_BACKTRACE; i++)
+    tlm_put_u32(body + 15 + 4 * i, c.backtrace[i]);
+}
+
+void tlm_unpack_crash(const uint8_t *body, tlm_crash_t &c)
+{
+  c.reset_reason = body[0];
+  c.cause = body[1];
+  c.backtrace_depth = body[2];
+  c.uptime_ms = tlm_get_u32(body + 3);
+  c.exc_cause = tlm_get_u32(body + 7);
+  c.exc_vaddr = tlm_get_u32(body + 11);
+  for (int i = 0; i < TLM_CRASH_BACKTRACE; i++)
+    c.backtrace[i] = tlm_get_u32(body + 15 + 4 * i);
+}
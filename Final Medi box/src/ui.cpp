@@ -0,0 +1,343 @@
+#include "ui.h"
+
+#include "big_font.h"
+#include "display_power.h"
+
+#define GLYPH_W 6 // default 5x7 font cell
+#define GLYPH_H 8
+#define PANEL_W 128
+#define PANEL_PAGES 8
+
+struct ui_rect_t
+{
+  int16_t x, y, w, h;
+};
+
+struct ui_layer_t
+{
+  Adafruit_SSD1306 *disp;
+  ui_rect_t box;
+  ui_style_t style;
+  bool visible;
+  bool dirty; // background needs drawing
+};
+
+struct ui_widget_t
+{
+  uint8_t layer;
+  int16_t x, y;
+  uint8_t size, width; // width in characters
+  bool big;            // drawn from big_font.h, size is its scale
+  uint8_t decimals;
+  const char *unit;
+  char text[UI_TEXT_MAX + 1];
+  int8_t dirty_lo, dirty_hi; // changed characters, lo > hi when clean
+};
+
+struct ui_panel_t
+{
+  Adafruit_SSD1306 *disp;
+  bool full;         // repaint everything
+  ui_rect_t damage;  // uncovered by a hidden layer, w == 0 when none
+  uint8_t col_lo[PANEL_PAGES], col_hi[PANEL_PAGES];
+};
+
+unsigned long ui_frame_interval_ms = 100;
+
+static ui_layer_t layers[UI_MAX_LAYERS];
+static ui_widget_t widgets[UI_MAX_WIDGETS];
+static ui_panel_t panels[2];
+static int n_layers = 0, n_widgets = 0, n_panels = 0;
+static unsigned long last_frame_ms = 0;
+
+static bool intersects(const ui_rect_t &a, const ui_rect_t &b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static bool contains(const ui_rect_t &outer, const ui_rect_t &r)
+{
+  return r.x >= outer.x && r.y >= outer.y && r.x + r.w <= outer.x + outer.w && r.y + r.h <= outer.y + outer.h;
+}
+
+static ui_rect_t span_rect(const ui_widget_t &w, int lo, int hi)
+{
+  int16_t cw = GLYPH_W * w.size;
+  return {(int16_t)(w.x + lo * cw), w.y, (int16_t)((hi - lo + 1) * cw), (int16_t)(GLYPH_H * w.size)};
+}
+
+static ui_panel_t &panel_of(Adafruit_SSD1306 &disp)
+{
+  for (int i = 0; i < n_panels; i++)
+    if (panels[i].disp == &disp)
+      return panels[i];
+  ui_panel_t &p = panels[n_panels++];
+  p.disp = &disp;
+  p.full = true;
+  p.damage = {0, 0, 0, 0};
+  memset(p.col_lo, 0xFF, sizeof(p.col_lo));
+  memset(p.col_hi, 0, sizeof(p.col_hi));
+  return p;
+}
+
+static void mark_pages(ui_panel_t &p, const ui_rect_t &r)
+{
+  int x0 = max(0, (int)r.x), x1 = min(PANEL_W - 1, r.x + r.w - 1);
+  int y0 = max(0, (int)r.y), y1 = min(PANEL_PAGES * 8 - 1, r.y + r.h - 1);
+  if (x0 > x1 || y0 > y1)
+    return;
+  for (int page = y0 / 8; page <= y1 / 8; page++)
+  {
+    p.col_lo[page] = min((int)p.col_lo[page], x0);
+    p.col_hi[page] = max((int)p.col_hi[page], x1);
+  }
+}
+
+static void mark_all(ui_widget_t &w)
+{
+  w.dirty_lo = 0;
+  w.dirty_hi = w.width - 1;
+}
+
+int ui_layer(Adafruit_SSD1306 &disp, int16_t x, int16_t y, int16_t w, int16_t h, ui_style_t style, bool visible)
+{
+  panel_of(disp);
+  layers[n_layers] = {&disp, {x, y, w, h}, style, visible, true};
+  return n_layers++;
+}
+
+int ui_label(int layer, int16_t x, int16_t y, uint8_t size, uint8_t width, const char *text)
+{
+  ui_widget_t &w = widgets[n_widgets];
+  w = {(uint8_t)layer, x, y, size, min(width, (uint8_t)UI_TEXT_MAX), false, 0, nullptr, "", 0, 0};
+  mark_all(w);
+  ui_set_text(n_widgets, text);
+  return n_widgets++;
+}
+
+int ui_big_label(int layer, int16_t x, int16_t y, uint8_t scale, uint8_t width, const char *text)
+{
+  int idx = ui_label(layer, x, y, scale, width, text);
+  widgets[idx].big = true;
+  return idx;
+}
+
+int ui_value(int layer, int16_t x, int16_t y, uint8_t size, uint8_t width, uint8_t decimals, const char *unit)
+{
+  int idx = ui_label(layer, x, y, size, width, "");
+  widgets[idx].decimals = decimals;
+  widgets[idx].unit = unit;
+  ui_set_value(idx, NAN);
+  return idx;
+}
+
+void ui_set_text(int widget, const char *text)
+{
+  ui_widget_t &w = widgets[widget];
+  bool ended_old = false, ended_new = false;
+  for (int i = 0; i < w.width; i++)
+  {
+    ended_old = ended_old || w.text[i] == '\0';
+    ended_new = ended_new || text[i] == '\0';
+    char old_c = ended_old ? ' ' : w.text[i];
+    char new_c = ended_new ? ' ' : text[i];
+    if (old_c != new_c)
+    {
+      if (w.dirty_lo > w.dirty_hi)
+        w.dirty_lo = w.dirty_hi = i;
+      w.dirty_lo = min((int)w.dirty_lo, i);
+      w.dirty_hi = max((int)w.dirty_hi, i);
+    }
+  }
+  strncpy(w.text, text, w.width);
+  w.text[w.width] = '\0';
+}
+
+void ui_set_value(int widget, float value)
+{
+  const ui_widget_t &w = widgets[widget];
+  char buf[UI_TEXT_MAX + 1];
+  if (isnan(value))
+    snprintf(buf, sizeof(buf), "-- %s", w.unit); // no reading yet, or the last read failed
+  else
+    snprintf(buf, sizeof(buf), "%.*f %s", w.decimals, value, w.unit);
+  ui_set_text(widget, buf);
+}
+
+void ui_show(int layer, bool visible)
+{
+  ui_layer_t &l = layers[layer];
+  if (l.visible == visible)
+    return;
+  l.visible = visible;
+  if (visible)
+  {
+    l.dirty = true;
+    return;
+  }
+  ui_panel_t &p = panel_of(*l.disp);
+  if (p.damage.w == 0)
+    p.damage = l.box;
+  else
+  {
+    int16_t x0 = min(p.damage.x, l.box.x), y0 = min(p.damage.y, l.box.y);
+    int16_t x1 = max(p.damage.x + p.damage.w, l.box.x + l.box.w);
+    int16_t y1 = max(p.damage.y + p.damage.h, l.box.y + l.box.h);
+    p.damage = {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+  }
+}
+
+void ui_invalidate(Adafruit_SSD1306 &disp)
+{
+  panel_of(disp).full = true;
+}
+
+// A higher opaque layer covers r completely, so drawing it would be wasted
+static bool occluded(int layer, const ui_rect_t &r)
+{
+  for (int i = layer + 1; i < n_layers; i++)
+    if (layers[i].disp == layers[layer].disp && layers[i].visible && layers[i].style != UI_PLAIN && contains(layers[i].box, r))
+      return true;
+  return false;
+}
+
+// Pixels under r were just overwritten: anything stacked above must be redrawn
+static void cascade(int layer, const ui_rect_t &r)
+{
+  for (int i = layer + 1; i < n_layers; i++)
+  {
+    ui_layer_t &l = layers[i];
+    if (l.disp != layers[layer].disp || !l.visible)
+      continue;
+    if (l.style != UI_PLAIN && intersects(l.box, r))
+      l.dirty = true;
+    else if (l.style == UI_PLAIN)
+      for (int j = 0; j < n_widgets; j++)
+        if (widgets[j].layer == i && intersects(span_rect(widgets[j], 0, widgets[j].width - 1), r))
+          mark_all(widgets[j]);
+  }
+}
+
+static void draw_widget(ui_panel_t &p, ui_widget_t &w)
+{
+  const ui_layer_t &l = layers[w.layer];
+  int lo = w.dirty_lo, hi = w.dirty_hi;
+  w.dirty_lo = 1;
+  w.dirty_hi = 0;
+  ui_rect_t r = span_rect(w, lo, hi);
+  if (occluded(w.layer, r))
+    return; // repainted from the damage rect when the cover goes away
+  uint16_t bg = l.style == UI_INVERTED ? SSD1306_WHITE : SSD1306_BLACK;
+  uint16_t fg = l.style == UI_INVERTED ? SSD1306_BLACK : SSD1306_WHITE;
+  Adafruit_SSD1306 &disp = *p.disp;
+  disp.fillRect(r.x, r.y, r.w, r.h, bg);
+  int len = strlen(w.text);
+  if (w.big)
+  {
+    for (int i = lo; i <= hi && i < len; i++)
+      big_font_draw(disp, w.x + i * GLYPH_W * w.size, w.y, w.size, w.text[i], l.style == UI_INVERTED);
+  }
+  else
+  {
+    disp.setTextSize(w.size);
+    disp.setTextColor(fg);
+    disp.setCursor(r.x, r.y);
+    for (int i = lo; i <= hi && i < len; i++)
+      disp.print(w.text[i]);
+  }
+  mark_pages(p, r);
+  cascade(w.layer, r);
+}
+
+static void draw_layer(ui_panel_t &p, int idx)
+{
+  ui_layer_t &l = layers[idx];
+  if (l.dirty)
+  {
+    l.dirty = false;
+    if (l.style != UI_PLAIN)
+    {
+      p.disp->fillRect(l.box.x, l.box.y, l.box.w, l.box.h, l.style == UI_INVERTED ? SSD1306_WHITE : SSD1306_BLACK);
+      if (l.style == UI_FRAMED)
+        p.disp->drawRect(l.box.x, l.box.y, l.box.w, l.box.h, SSD1306_WHITE);
+      mark_pages(p, l.box);
+      cascade(idx, l.box);
+    }
+    for (int j = 0; j < n_widgets; j++)
+      if (widgets[j].layer == idx)
+        mark_all(widgets[j]);
+  }
+  for (int j = 0; j < n_widgets; j++)
+    if (widgets[j].layer == idx && widgets[j].dirty_lo <= widgets[j].dirty_hi)
+      draw_widget(p, widgets[j]);
+}
+
+static void render_panel(ui_panel_t &p)
+{
+  if (!panel_visible(*p.disp))
+    return; // keep the invalid regions until it is lit again
+
+  if (p.full)
+  {
+    p.disp->clearDisplay();
+    p.damage = {0, 0, PANEL_W, PANEL_PAGES * 8};
+    p.full = false;
+  }
+  if (p.damage.w != 0)
+  {
+    p.disp->fillRect(p.damage.x, p.damage.y, p.damage.w, p.damage.h, SSD1306_BLACK);
+    mark_pages(p, p.damage);
+    for (int i = 0; i < n_layers; i++)
+    {
+      ui_layer_t &l = layers[i];
+      if (l.disp != p.disp || !l.visible)
+        continue;
+      if (l.style != UI_PLAIN && intersects(l.box, p.damage))
+        l.dirty = true;
+      for (int j = 0; j < n_widgets; j++)
+        if (widgets[j].layer == i && intersects(span_rect(widgets[j], 0, widgets[j].width - 1), p.damage))
+          mark_all(widgets[j]);
+    }
+    p.damage = {0, 0, 0, 0};
+  }
+
+  for (int i = 0; i < n_layers; i++)
+    if (layers[i].disp == p.disp && layers[i].visible)
+      draw_layer(p, i);
+}
+
+// Pages rendered but not yet sent, possibly left over from an earlier pass
+static void flush_panel(ui_panel_t &p, bool budgeted)
+{
+  if (!panel_visible(*p.disp))
+    return;
+  for (int page = 0; page < PANEL_PAGES; page++)
+    if (p.col_lo[page] <= p.col_hi[page])
+    {
+      panel_flush_pages(*p.disp, p.col_lo, p.col_hi, budgeted);
+      return;
+    }
+}
+
+void ui_refresh()
+{
+  last_frame_ms = millis();
+  for (int i = 0; i < n_panels; i++)
+  {
+    render_panel(panels[i]);
+    flush_panel(panels[i], false);
+  }
+}
+
+void ui_update()
+{
+  bool frame_due = millis() - last_frame_ms >= ui_frame_interval_ms;
+  if (frame_due)
+    last_frame_ms = millis();
+  for (int i = 0; i < n_panels; i++)
+  {
+    if (frame_due)
+      render_panel(panels[i]);
+    flush_panel(panels[i], true);
+  }
+}
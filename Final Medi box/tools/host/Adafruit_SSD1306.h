@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Adafruit_GFX.h"
+#include "Wire.h"
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_SETCONTRAST 0x81
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+
+// Glyph-level model of the panel: the buffer holds the characters drawn
+// at each position (default 6x8 font cell times the text size), and each
+// flush logs its rows whenever they changed, which is what replays are
+// compared on. Pixel drawing other than clearing is not modelled.
+class Adafruit_SSD1306 : public Print
+{
+public:
+  Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin = -1);
+
+  bool begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = 0);
+  void display();
+  void clearDisplay();
+  void ssd1306_command(uint8_t c);
+  uint8_t *getBuffer() { return buffer_; }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
+  void setTextSize(uint8_t s) { size_ = s; }
+  void setTextColor(uint16_t c) {}
+  void setCursor(int16_t x, int16_t y);
+  using Print::write;
+  size_t write(const uint8_t *buf, size_t n) override;
+
+  // Host only: a data transfer reached the panel over its bus
+  void host_flushed();
+  uint8_t host_address() const { return addr_; }
+  int host_id() const { return id_; }
+
+private:
+  struct glyph
+  {
+    int16_t x, y;
+    uint8_t size;
+    char c;
+  };
+
+  int id_;
+  uint8_t addr_ = 0x3C; // strapped; answers before begin()
+  std::vector<glyph> glyphs_;
+  int16_t cursor_x_ = 0, cursor_y_ = 0;
+  uint8_t size_ = 1;
+  std::string last_flushed_;
+  uint8_t buffer_[128 * 64 / 8] = {};
+
+  void erase(int16_t x, int16_t y, int16_t w, int16_t h);
+  std::string rows() const;
+};
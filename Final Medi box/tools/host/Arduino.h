@@ -0,0 +1,144 @@
+#pragma once
+
+// Minimal Arduino core for the host replay build (see tools/replay).
+// Only what the firmware uses is provided; time is virtual and advanced
+// by delay() and by a small fixed cost per call into the core.
+
+#include <algorithm>
+#include <cmath>
+#include <math.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include <time.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define RISING 0x01
+#define FALLING 0x02
+
+// Wall time follows the replayed SNTP adjustments, not the host clock
+int host_gettimeofday(struct timeval *tv, void *tz);
+int host_settimeofday(const struct timeval *tv, void *tz);
+#define gettimeofday(tv, tz) host_gettimeofday(tv, tz)
+#define settimeofday(tv, tz) host_settimeofday(tv, tz)
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define F(s) (s)
+
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::min;
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(m) ((void)(m))
+#define portEXIT_CRITICAL(m) ((void)(m))
+#define portENTER_CRITICAL_ISR(m) ((void)(m))
+#define portEXIT_CRITICAL_ISR(m) ((void)(m))
+#define portENTER_CRITICAL_SAFE(m) ((void)(m))
+#define portEXIT_CRITICAL_SAFE(m) ((void)(m))
+
+class String
+{
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, int decimals = 2) { fmt(v, decimals); }
+  String(double v, int decimals = 2) { fmt(v, decimals); }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned length() const { return s_.size(); }
+  String &operator+=(const String &o)
+  {
+    s_ += o.s_;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+
+private:
+  void fmt(double v, int decimals)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s_ = buf;
+  }
+  std::string s_;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t *buf, size_t n) = 0;
+  size_t write(const char *s, size_t n) { return write((const uint8_t *)s, n); }
+
+  size_t print(const char *s) { return write(s, strlen(s)); }
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(char c) { return write(&c, 1); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+  template <typename T>
+  size_t println(const T &v)
+  {
+    size_t n = print(v);
+    return n + print("\n");
+  }
+  size_t println() { return print("\n"); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print
+{
+public:
+  using Print::write;
+  void setTxBufferSize(size_t) {}
+  void begin(unsigned long) {}
+  void flush() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 4096; }
+  size_t write(const uint8_t *buf, size_t n) override;
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
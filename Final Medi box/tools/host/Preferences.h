@@ -0,0 +1,40 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Arduino.h"
+
+// In-memory NVS: every replay starts from erased flash
+class Preferences
+{
+public:
+  bool begin(const char *name, bool read_only = false)
+  {
+    ns_ = name;
+    return true;
+  }
+  void end() {}
+  size_t putBytes(const char *key, const void *value, size_t len)
+  {
+    const uint8_t *p = (const uint8_t *)value;
+    store()[ns_ + "/" + key].assign(p, p + len);
+    return len;
+  }
+  size_t getBytes(const char *key, void *buf, size_t max_len)
+  {
+    auto it = store().find(ns_ + "/" + key);
+    if (it == store().end() || it->second.size() > max_len)
+      return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+private:
+  static std::map<std::string, std::vector<uint8_t>> &store()
+  {
+    static std::map<std::string, std::vector<uint8_t>> s;
+    return s;
+  }
+  std::string ns_;
+};
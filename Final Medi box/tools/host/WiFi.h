@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class WiFiClass
+{
+public:
+  int begin(const char *ssid, const char *pass = nullptr, int channel = 0) { return status(); }
+  int status() { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire
+{
+public:
+  explicit TwoWire(int bus) : bus_(bus) {}
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+  void setClock(uint32_t hz) { clock_hz_ = hz; }
+  void setTimeOut(uint16_t ms) {}
+  void beginTransmission(uint8_t addr)
+  {
+    addr_ = addr;
+    tx_.clear();
+  }
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *data, size_t n);
+  uint8_t endTransmission(bool send_stop = true); // 2 = address NACK
+  uint8_t requestFrom(uint8_t addr, uint8_t n);    // only the OLEDs answer
+  int read() { return -1; }
+
+private:
+  int bus_;
+  uint32_t clock_hz_ = 100000;
+  uint8_t addr_ = 0;
+  std::vector<uint8_t> tx_;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
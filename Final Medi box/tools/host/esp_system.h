@@ -0,0 +1,24 @@
+#pragma once
+
+typedef enum
+{
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+} esp_reset_reason_t;
+
+typedef void (*shutdown_handler_t)(void);
+
+// A replay always starts from power-on; a restart runs the shutdown
+// handlers and ends it
+esp_reset_reason_t esp_reset_reason();
+[[noreturn]] void esp_restart();
+int esp_register_shutdown_handler(shutdown_handler_t handler);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct host_timer *esp_timer_handle_t;
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef struct
+{
+  void (*callback)(void *arg);
+  void *arg;
+  int dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// Callbacks run synchronously when virtual time passes their deadline
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
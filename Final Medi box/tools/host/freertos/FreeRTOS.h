@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef uint32_t UBaseType_t;
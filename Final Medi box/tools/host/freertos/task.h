@@ -0,0 +1,7 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Every task the firmware looks up exists and has stack to spare
+TaskHandle_t xTaskGetHandle(const char *name);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
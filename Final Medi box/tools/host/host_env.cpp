@@ -0,0 +1,624 @@
+#include "host_env.h"
+
+#include <cstdarg>
+#include <map>
+
+#include <Adafruit_SSD1306.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include "big_font.h"
+#include "clock_sync.h"
+#include "telemetry_frame.h"
+#include "dht_rmt.h"
+
+// Modelled costs of the calls that dominate a loop iteration on the device
+#define COST_DIGITAL_READ_US 2
+#define COST_GET_TIME_US 20
+#define COST_DISPLAY_FLUSH_US 25000 // 1 KiB over I2C at 400 kHz
+#define COST_DHT_READ_US 5000
+
+HardwareSerial Serial;
+TwoWire Wire(0);
+TwoWire Wire1(1);
+WiFiClass WiFi;
+
+static std::vector<trace_record_t> trace;
+static size_t next_record = 0;
+static uint64_t now_us = 0;
+static uint64_t end_us = 0;
+
+static std::map<uint8_t, int> pin_level;
+static std::map<uint8_t, std::pair<void (*)(void *), void *>> isr_arg;
+static std::map<uint8_t, void (*)()> isr_plain;
+
+static bool climate_valid = false;
+static float climate_temp = NAN, climate_hum = NAN;
+
+static bool clock_set = false;
+static uint32_t clock_epoch = 0;
+static uint64_t clock_anchor_us = 0;
+static long tz_offset_sec = 0;
+static clock_adjust_cb_t sync_cb = nullptr;
+
+struct host_timer
+{
+  void (*callback)(void *);
+  void *arg;
+  bool armed;
+  uint64_t deadline_us;
+  uint64_t period_us;
+};
+static std::vector<host_timer *> timers;
+
+static std::vector<std::string> output_log;
+static bool serial_echo = false;
+
+static void apply(const trace_record_t &rec)
+{
+  if (rec.kind == TRACE_BUTTON)
+  {
+    pin_level[rec.arg] = rec.a;
+    auto it = isr_arg.find(rec.arg);
+    if (it != isr_arg.end())
+      it->second.first(it->second.second);
+    auto plain = isr_plain.find(rec.arg);
+    if (plain != isr_plain.end())
+      plain->second();
+  }
+  else if (rec.kind == TRACE_CLIMATE && (rec.arg >> 1) == 0) // only the DHT22 is modelled
+  {
+    climate_valid = (rec.arg & 1) == 0;
+    climate_temp = rec.a / 10.0f;
+    climate_hum = rec.b / 10.0f;
+  }
+  else if (rec.kind == TRACE_CLOCK)
+  {
+    clock_set = true;
+    clock_epoch = (uint32_t)rec.b;
+    clock_anchor_us = now_us;
+    if (sync_cb)
+    {
+      struct timeval tv = {(time_t)clock_epoch, 0};
+      sync_cb(&tv);
+    }
+  }
+}
+
+void host_load_trace(const std::vector<trace_record_t> &records, unsigned long tail_ms)
+{
+  trace = records;
+  next_record = 0;
+  now_us = trace.empty() ? 0 : (uint64_t)trace.front().t_ms * 1000;
+  end_us = (trace.empty() ? 0 : (uint64_t)trace.back().t_ms * 1000) + (uint64_t)tail_ms * 1000;
+
+  // Buttons idle high (external pull-ups) until the trace says otherwise
+  pin_level.clear();
+  for (uint8_t pin : {2, 4, 5, 23})
+    pin_level[pin] = HIGH;
+  while (next_record < trace.size() && (uint64_t)trace[next_record].t_ms * 1000 <= now_us)
+    apply(trace[next_record++]);
+}
+
+static host_timer *earliest_timer()
+{
+  host_timer *best = nullptr;
+  for (host_timer *t : timers)
+    if (t->armed && (!best || t->deadline_us < best->deadline_us))
+      best = t;
+  return best;
+}
+
+// Trace records and timer expiries are delivered in time order
+void host_advance_us(uint64_t us)
+{
+  uint64_t target = now_us + us;
+  for (;;)
+  {
+    uint64_t t_rec = next_record < trace.size() ? (uint64_t)trace[next_record].t_ms * 1000 : UINT64_MAX;
+    host_timer *timer = earliest_timer();
+    uint64_t t_timer = timer ? timer->deadline_us : UINT64_MAX;
+    uint64_t t = std::min(t_rec, t_timer);
+    if (t > target)
+      break;
+    now_us = std::max(now_us, t);
+    if (t_timer <= t_rec)
+    {
+      timer->armed = timer->period_us != 0;
+      timer->deadline_us += timer->period_us;
+      timer->callback(timer->arg);
+    }
+    else
+      apply(trace[next_record++]);
+  }
+  now_us = target;
+  if (now_us > end_us)
+    throw host_replay_done();
+}
+
+uint64_t host_now_us()
+{
+  return now_us;
+}
+
+void host_output(const char *fmt, ...)
+{
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), "%10.3f ", now_us / 1e6);
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf + n, sizeof(buf) - n, fmt, args);
+  va_end(args);
+  output_log.push_back(buf);
+}
+
+const std::vector<std::string> &host_output_log()
+{
+  return output_log;
+}
+
+void host_set_serial_echo(bool echo)
+{
+  serial_echo = echo;
+}
+
+// Arduino core
+
+size_t Print::printf(const char *fmt, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return write(buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+// The UART carries telemetry frames; text frames are echoed as lines and
+// data frames as a short tag
+size_t HardwareSerial::write(const uint8_t *buf, size_t n)
+{
+  static uint8_t frame[TLM_MAX_FRAME];
+  static size_t len = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (buf[i] != 0)
+    {
+      if (len < sizeof(frame))
+        frame[len++] = buf[i];
+      continue;
+    }
+    uint8_t record[TLM_MAX_FRAME];
+    size_t r = tlm_cobs_decode(frame, len, record);
+    len = 0;
+    if (!serial_echo || r < TLM_HEADER_BYTES + TLM_CRC_BYTES)
+      continue;
+    size_t body = r - TLM_HEADER_BYTES - TLM_CRC_BYTES;
+    if (record[0] == TLM_TEXT)
+      fprintf(stderr, "%.*s\n", (int)body, (const char *)record + TLM_HEADER_BYTES);
+    else if (record[0] == TLM_LOG && body > 0)
+      fprintf(stderr, "[log %u] %.*s\n", record[TLM_HEADER_BYTES], (int)body - 1, (const char *)record + TLM_HEADER_BYTES + 1);
+    else
+      fprintf(stderr, "[telemetry type=%u seq=%u]\n", record[0], tlm_get_u16(record + 1));
+  }
+  return n;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)now_us;
+}
+
+void delay(unsigned long ms)
+{
+  host_advance_us((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  host_advance_us(us);
+}
+
+void yield()
+{
+  host_advance_us(1);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+int digitalRead(uint8_t pin)
+{
+  host_advance_us(COST_DIGITAL_READ_US);
+  auto it = pin_level.find(pin);
+  return it == pin_level.end() ? LOW : it->second;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+  auto it = pin_level.find(pin);
+  if (it == pin_level.end() || it->second != level)
+    host_output("PIN%u %s", pin, level ? "HIGH" : "LOW");
+  pin_level[pin] = level;
+}
+
+static unsigned int tone_freq = 0;
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration)
+{
+  if (frequency != tone_freq)
+    host_output("TONE %u Hz", frequency);
+  tone_freq = frequency;
+}
+
+void noTone(uint8_t pin)
+{
+  if (tone_freq != 0)
+    host_output("TONE off");
+  tone_freq = 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode)
+{
+  isr_plain[pin] = isr;
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode)
+{
+  isr_arg[pin] = {isr, arg};
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  isr_plain.erase(pin);
+  isr_arg.erase(pin);
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms)
+{
+  host_advance_us(COST_GET_TIME_US);
+  // Like the core, poll every 10 ms until the clock is set or we time out
+  for (uint32_t waited = 0; !clock_set; waited += 10)
+  {
+    if (waited >= ms)
+      return false;
+    delay(10);
+  }
+  time_t t = clock_epoch + (time_t)((now_us - clock_anchor_us) / 1000000) + tz_offset_sec;
+  gmtime_r(&t, info);
+  return true;
+}
+
+int host_gettimeofday(struct timeval *tv, void *tz)
+{
+  uint64_t elapsed = clock_set ? now_us - clock_anchor_us : now_us;
+  tv->tv_sec = (clock_set ? clock_epoch : 0) + (time_t)(elapsed / 1000000);
+  tv->tv_usec = (suseconds_t)(elapsed % 1000000);
+  return 0;
+}
+
+int host_settimeofday(const struct timeval *tv, void *tz)
+{
+  clock_set = true;
+  clock_epoch = (uint32_t)tv->tv_sec;
+  clock_anchor_us = now_us - tv->tv_usec;
+  return 0;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+  *out = new host_timer{args->callback, args->arg, false, 0, 0};
+  timers.push_back(*out);
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+  *timer = {timer->callback, timer->arg, true, now_us + timeout_us, 0};
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+  *timer = {timer->callback, timer->arg, true, now_us + period_us, period_us};
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  timers.erase(std::find(timers.begin(), timers.end(), timer));
+  delete timer;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time()
+{
+  return (int64_t)now_us;
+}
+
+// Clock discipline: the trace's clock records are the steps the device
+// made, so they are delivered to the adjust callback as they come due
+
+static clock_sync_stats_t clock_stats = {false, 0, 0, 0, 0, 0, 0.0f, CLOCK_MIN_INTERVAL_MS, 0};
+
+void clock_sync_begin(const char *ssid, const char *password, int channel, clock_adjust_cb_t on_adjust)
+{
+  sync_cb = on_adjust;
+}
+
+void clock_sync_update()
+{
+}
+
+void clock_set_utc_offset(long seconds)
+{
+  tz_offset_sec = seconds;
+}
+
+const clock_sync_stats_t &clock_sync_stats()
+{
+  clock_stats.synced = clock_set;
+  return clock_stats;
+}
+
+// System
+
+esp_reset_reason_t esp_reset_reason()
+{
+  return ESP_RST_POWERON;
+}
+
+static std::vector<shutdown_handler_t> shutdown_handlers;
+
+int esp_register_shutdown_handler(shutdown_handler_t handler)
+{
+  shutdown_handlers.push_back(handler);
+  return 0;
+}
+
+void esp_restart()
+{
+  for (shutdown_handler_t h : shutdown_handlers)
+    h();
+  host_output("restart");
+  throw host_replay_done();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+  return 180 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+  return 160 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+  return 110 * 1024;
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+  return (TaskHandle_t)name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  return 2048;
+}
+
+// Peripherals
+
+// The read completes COST_DHT_READ_US after the request with the trace's
+// current climate sample, like the RMT capture finishing on the device
+static void dht_complete(void *arg)
+{
+  ((DhtRmt *)arg)->complete({climate_valid ? climate_temp : NAN, climate_valid ? climate_hum : NAN, climate_valid, millis()});
+}
+
+bool DhtRmt::setup(uint8_t pin, DHT_MODEL_t model)
+{
+  pin_ = pin;
+  esp_timer_create_args_t args = {};
+  args.callback = dht_complete;
+  args.arg = this;
+  esp_timer_handle_t timer;
+  esp_timer_create(&args, &timer);
+  task_ = timer;
+  return true;
+}
+
+bool DhtRmt::request()
+{
+  unsigned long now = millis();
+  if (busy_ || task_ == nullptr || (requested_once_ && now - last_request_ms_ < (unsigned long)getMinimumSamplingPeriod()))
+    return false;
+  busy_ = true;
+  requested_once_ = true;
+  last_request_ms_ = now;
+  esp_timer_start_once((esp_timer_handle_t)task_, COST_DHT_READ_US);
+  return true;
+}
+
+static int n_panels = 0;
+static bool panel_absent[3] = {false, false, false};
+
+void host_set_panel_absent(int id)
+{
+  if (id >= 1 && id <= 2)
+    panel_absent[id] = true;
+}
+
+// The panels are globals of the firmware, constructed before this file's
+// statics may be
+static std::map<TwoWire *, Adafruit_SSD1306 *> &panel_on_bus()
+{
+  static std::map<TwoWire *, Adafruit_SSD1306 *> panels;
+  return panels;
+}
+
+size_t TwoWire::write(uint8_t b)
+{
+  tx_.push_back(b);
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t n)
+{
+  tx_.insert(tx_.end(), data, data + n);
+  return n;
+}
+
+// Address byte plus payload, 9 clocks per byte with the ACK
+uint8_t TwoWire::endTransmission(bool send_stop)
+{
+  auto it = panel_on_bus().find(this);
+  if (it == panel_on_bus().end() || addr_ != it->second->host_address() || panel_absent[it->second->host_id()])
+  {
+    host_advance_us(9 * 1000000 / clock_hz_);
+    return 2;
+  }
+  host_advance_us((uint64_t)(tx_.size() + 1) * 9 * 1000000 / clock_hz_);
+  if (!tx_.empty() && tx_[0] == 0x40)
+    it->second->host_flushed();
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t n)
+{
+  host_advance_us(9 * 1000000 / clock_hz_);
+  return 0;
+}
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst_pin)
+    : id_(++n_panels)
+{
+  panel_on_bus()[twi] = this;
+}
+
+bool Adafruit_SSD1306::begin(uint8_t switchvcc, uint8_t i2caddr)
+{
+  addr_ = i2caddr;
+  return true;
+}
+
+void Adafruit_SSD1306::display()
+{
+  host_advance_us(COST_DISPLAY_FLUSH_US);
+  host_flushed();
+}
+
+void Adafruit_SSD1306::host_flushed()
+{
+  std::string text = rows();
+  if (text != last_flushed_)
+    host_output("OLED%d %s", id_, text.c_str());
+  last_flushed_ = text;
+}
+
+void Adafruit_SSD1306::ssd1306_command(uint8_t c)
+{
+  host_output("OLED%d cmd 0x%02X", id_, c);
+}
+
+void Adafruit_SSD1306::clearDisplay()
+{
+  glyphs_.clear();
+}
+
+void Adafruit_SSD1306::erase(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  glyphs_.erase(std::remove_if(glyphs_.begin(), glyphs_.end(),
+                               [&](const glyph &g)
+                               {
+                                 return g.x < x + w && x < g.x + 6 * g.size && g.y < y + h && y < g.y + 8 * g.size;
+                               }),
+                glyphs_.end());
+}
+
+void Adafruit_SSD1306::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  erase(x, y, w, h);
+}
+
+void Adafruit_SSD1306::setCursor(int16_t x, int16_t y)
+{
+  cursor_x_ = x;
+  cursor_y_ = y;
+}
+
+size_t Adafruit_SSD1306::write(const uint8_t *buf, size_t n)
+{
+  const char *s = (const char *)buf;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (s[i] == '\n')
+    {
+      cursor_x_ = 0;
+      cursor_y_ += 8 * size_;
+      continue;
+    }
+    if (cursor_x_ + 6 * size_ > 128) // text wrap
+    {
+      cursor_x_ = 0;
+      cursor_y_ += 8 * size_;
+    }
+    erase(cursor_x_, cursor_y_, 6 * size_, 8 * size_);
+    if (s[i] != ' ')
+      glyphs_.push_back({cursor_x_, cursor_y_, size_, s[i]});
+    cursor_x_ += 6 * size_;
+  }
+  return n;
+}
+
+// The device blits page rows from flash; here the glyph is recorded like text
+void big_font_draw(Adafruit_SSD1306 &disp, int16_t x, int16_t y, uint8_t scale, char c, bool invert)
+{
+  if (!big_font_has(c))
+    return;
+  disp.setTextSize(scale);
+  disp.setCursor(x, y);
+  disp.print(c);
+}
+
+// One "|"-prefixed row per text line, glyphs in x order with a space
+// wherever a cell is left empty
+std::string Adafruit_SSD1306::rows() const
+{
+  std::vector<glyph> sorted = glyphs_;
+  std::sort(sorted.begin(), sorted.end(), [](const glyph &a, const glyph &b)
+            { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+  std::string out;
+  int16_t row_y = -1, next_x = 0;
+  for (const glyph &g : sorted)
+  {
+    if (g.y != row_y)
+    {
+      out += "|";
+      row_y = g.y;
+      next_x = g.x;
+    }
+    if (g.x > next_x)
+      out += " ";
+    out += g.c;
+    next_x = g.x + 6 * g.size;
+  }
+  return out;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "input_trace.h"
+
+// Virtual device driven by a recorded input trace. Time only moves when
+// the firmware waits or calls into the core, so a replay runs as fast as
+// the host allows and is fully deterministic.
+//
+// Not everything the device runs is replayed. host_env.cpp stands in for:
+//
+//   clock_sync   no WiFi or SNTP: the trace's clock records are the steps
+//                the device made and go straight to the adjust callback
+//   dht_rmt      no RMT capture or pulse decoding: a read completes after
+//                a fixed delay with the trace's current climate sample
+//   SHT3x/BME280 nothing answers on I2C but the panels, so they are absent
+//   big_font     glyphs are recorded as text, not blitted from flash
+//   panels       SSD1306 output is recorded as text rows and commands
+//   crash        no panic hook or backtrace walk
+//   boot jobs    run inline instead of on their own task
+//
+// Bugs in those paths do not show up in a replay.
+
+struct host_replay_done
+{
+};
+
+void host_load_trace(const std::vector<trace_record_t> &records, unsigned long tail_ms);
+void host_advance_us(uint64_t us);
+uint64_t host_now_us();
+
+// Screen, buzzer and LED changes observed during the replay
+void host_output(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+const std::vector<std::string> &host_output_log();
+void host_set_serial_echo(bool echo);
+
+// The panel (1 or 2) is not fitted and never answers on its bus
+void host_set_panel_absent(int id);
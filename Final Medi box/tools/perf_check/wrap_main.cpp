@@ -0,0 +1,116 @@
+// Host check of perf trace timestamps across the cycle counter's wrap
+// (see include/perf_trace.h):
+//
+//   pio run -e perf_check && .pio/build/perf_check/program
+//
+// Each event carries its virtual esp_timer time as its argument, so every
+// line of a dump must print the same number twice. The exit status is
+// non-zero on any mismatch.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "host_env.h"
+#include "perf_trace.h"
+
+#define CYCLE_WRAP_US ((1ULL << 32) / 240) // the host counts 240 cycles per µs
+
+struct capture_t : Print
+{
+  std::string text;
+  size_t write(const uint8_t *buf, size_t n) override
+  {
+    text.append((const char *)buf, n);
+    return n;
+  }
+  using Print::write;
+};
+
+static int failures = 0;
+
+static void instant(const char *name)
+{
+  perf_instant(name, (uint32_t)host_now_us());
+}
+
+// Dumps the ring and checks its header counts and every event's time
+static void check_dump(const char *what, unsigned long events, unsigned long untimed, unsigned long printed)
+{
+  capture_t out;
+  perf_trace_dump(out);
+  unsigned long n_events = 0, n_overwritten = 0, n_skipped = 0, n_untimed = 0, n_printed = 0;
+  const char *p = out.text.c_str();
+  if (sscanf(p, "# medibox-perf v1 events=%lu overwritten=%lu skipped=%lu untimed=%lu", &n_events, &n_overwritten,
+             &n_skipped, &n_untimed) != 4)
+  {
+    printf("%s: bad header: %.60s\n", what, p);
+    failures++;
+    return;
+  }
+  if (n_events != events || n_untimed != untimed)
+  {
+    printf("%s: events=%lu untimed=%lu, expected %lu and %lu\n", what, n_events, n_untimed, events, untimed);
+    failures++;
+  }
+  for (p = strchr(p, '\n'); p != nullptr && strncmp(p + 1, "# end", 5); p = strchr(p + 1, '\n'))
+  {
+    char type;
+    unsigned long t_us, arg;
+    unsigned ctx;
+    int name_at = 0;
+    if (sscanf(p + 1, "%c,%lu,%u,%lu,%n", &type, &t_us, &ctx, &arg, &name_at) != 4)
+      continue;
+    n_printed++;
+    if (t_us != arg)
+    {
+      printf("%s: %.*s dated %lu, recorded at %lu\n", what, (int)strcspn(p + 1 + name_at, "\n"), p + 1 + name_at,
+             t_us, arg);
+      failures++;
+    }
+  }
+  if (n_printed != printed)
+  {
+    printf("%s: %lu events printed, expected %lu\n", what, n_printed, printed);
+    failures++;
+  }
+}
+
+int main()
+{
+  host_load_trace({}, 600000);
+
+  // A quiet spell of two whole wraps and half a second must still take a
+  // new anchor, and the next event stays on it
+  host_advance_us(1000000);
+  instant("start");
+  host_advance_us(2 * CYCLE_WRAP_US + 500000);
+  instant("after wraps");
+  host_advance_us(300000);
+  instant("same anchor");
+  check_dump("quiet spell", 5, 0, 3);
+
+  // Once the ring overwrites an anchor, its events before the next one
+  // are left out rather than dated from it
+  host_advance_us(2000000);
+  instant("anchor lost");
+  host_advance_us(500000);
+  instant("stale");
+  host_advance_us(2000000);
+  instant("fresh");
+  for (int i = 0; i < PERF_TRACE_CAPACITY - 4; i++)
+  {
+    host_advance_us(100);
+    instant("fill");
+  }
+  check_dump("overwritten anchor", PERF_TRACE_CAPACITY, 2, PERF_TRACE_CAPACITY - 3);
+
+  if (failures)
+  {
+    printf("perf_check: %d failures\n", failures);
+    return 1;
+  }
+  printf("perf_check: ok\n");
+  return 0;
+}
@@ -0,0 +1,138 @@
+// Host converter from the firmware's perf trace dump (see
+// include/perf_trace.h) to Chrome trace JSON, which Perfetto
+// (ui.perfetto.dev) and chrome://tracing open:
+//
+//   .pio/build/telemetry_decode/program --text capture.bin > dump.txt
+//   .pio/build/perf_trace_json/program dump.txt > trace.json
+//
+// Input is a console capture containing an 'F' dump; other lines are
+// ignored. Each execution context (core, and interrupts on each core) is
+// a thread of its own. Timestamps start at the earliest event and survive
+// the device's 32-bit microsecond wrap. An end whose begin was
+// overwritten in the ring is dropped, so every slice is well formed.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct perf_line_t
+{
+  char type;
+  unsigned long t_us;
+  unsigned ctx;
+  unsigned long arg;
+  std::string name;
+  unsigned long long t; // unwrapped
+};
+
+static bool parse(const char *line, perf_line_t &e)
+{
+  char type;
+  int name_at = -1;
+  if (sscanf(line, "%c,%lu,%u,%lu,%n", &type, &e.t_us, &e.ctx, &e.arg, &name_at) != 4 || name_at < 0)
+    return false;
+  if (type != 'B' && type != 'E' && type != 'I')
+    return false;
+  e.type = type;
+  e.name = line + name_at;
+  while (!e.name.empty() && (e.name.back() == '\n' || e.name.back() == '\r'))
+    e.name.pop_back();
+  return e.ctx < 4;
+}
+
+static std::string json_string(const std::string &s)
+{
+  std::string out = "\"";
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((unsigned char)c >= 0x20)
+      out += c;
+  }
+  return out + "\"";
+}
+
+static const char *context_names[4] = {"core 0", "core 1 (loop)", "core 0 ISR", "core 1 ISR"};
+
+int main(int argc, char **argv)
+{
+  FILE *in = argc > 1 ? fopen(argv[1], "r") : stdin;
+  if (in == nullptr)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  char line[256];
+  bool in_dump = false;
+  unsigned long long wraps = 0;
+  std::vector<perf_line_t> events;
+  std::vector<std::string> open[4]; // begun slices per context
+  unsigned long dropped = 0;
+  while (fgets(line, sizeof(line), in))
+  {
+    if (!strncmp(line, "# medibox-perf", 14))
+    {
+      in_dump = true;
+      continue;
+    }
+    if (!strncmp(line, "# end", 5))
+      in_dump = false;
+    perf_line_t e;
+    if (!in_dump || !parse(line, e))
+      continue;
+
+    // The cores' events interleave slightly out of order; only a step
+    // back of half the range is a wrap
+    e.t = wraps + e.t_us;
+    if (!events.empty() && e.t + (1ULL << 31) < events.back().t)
+    {
+      wraps += 1ULL << 32;
+      e.t += 1ULL << 32;
+    }
+
+    std::vector<std::string> &stack = open[e.ctx];
+    if (e.type == 'B')
+      stack.push_back(e.name);
+    else if (e.type == 'E')
+    {
+      if (stack.empty() || stack.back() != e.name)
+      {
+        dropped++;
+        continue;
+      }
+      stack.pop_back();
+    }
+    events.push_back(e);
+  }
+
+  unsigned long long base = ~0ULL;
+  bool used[4] = {};
+  for (const perf_line_t &e : events)
+  {
+    base = std::min(base, e.t);
+    used[e.ctx] = true;
+  }
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  const char *sep = "";
+  for (const perf_line_t &e : events)
+  {
+    printf("%s{\"name\":%s,\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%lu}%s}", sep,
+           json_string(e.name).c_str(), e.type == 'I' ? 'i' : e.type, e.t - base, e.ctx, e.arg,
+           e.type == 'I' ? ",\"s\":\"t\"" : "");
+    sep = ",\n";
+  }
+  for (unsigned ctx = 0; ctx < 4; ctx++)
+    if (used[ctx])
+    {
+      printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", sep, ctx,
+             context_names[ctx]);
+      sep = ",\n";
+    }
+  printf("\n]}\n");
+  fprintf(stderr, "%zu events, %lu unmatched ends dropped\n", events.size(), dropped);
+  return 0;
+}
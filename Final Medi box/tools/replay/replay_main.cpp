@@ -0,0 +1,125 @@
+// Host replay driver: runs the firmware's setup()/loop() against a trace
+// dumped from a device ('T' on the serial console) and prints every
+// screen, buzzer and LED change with its virtual timestamp.
+//
+//   pio run -e replay
+//   .pio/build/replay/program trace.txt [--tail-ms N] [--expect golden.txt] [--serial]
+//                                       [--absent-oled N]
+//
+// --absent-oled replays with OLED N (1 or 2) missing from its bus.
+//
+// With --expect the output is compared against a previous replay and the
+// exit status is non-zero on any difference, so field traces can be kept
+// as regression tests. They live in tools/replay/traces, each <name>.txt
+// with its <name>.expected replayed with the default --tail-ms:
+//
+//   for t in tools/replay/traces/*.txt; do
+//     .pio/build/replay/program $t --expect ${t%.txt}.expected || echo FAIL $t
+//   done
+//
+// See tools/host/host_env.h for what the host build does not run.
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "host_env.h"
+
+void setup();
+void loop();
+
+static bool load_trace(const char *path, std::vector<trace_record_t> &records)
+{
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    trace_record_t rec;
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (trace_parse_line(line.c_str(), rec))
+      records.push_back(rec);
+    else
+      std::cerr << "skipping malformed line: " << line << "\n";
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *trace_path = nullptr;
+  const char *expect_path = nullptr;
+  unsigned long tail_ms = 10000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--tail-ms") && i + 1 < argc)
+      tail_ms = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--expect") && i + 1 < argc)
+      expect_path = argv[++i];
+    else if (!strcmp(argv[i], "--serial"))
+      host_set_serial_echo(true);
+    else if (!strcmp(argv[i], "--absent-oled") && i + 1 < argc)
+      host_set_panel_absent(atoi(argv[++i]));
+    else
+      trace_path = argv[i];
+  }
+  if (!trace_path)
+  {
+    std::cerr << "usage: " << argv[0] << " trace.txt [--tail-ms N] [--expect golden.txt] [--serial] [--absent-oled N]\n";
+    return 2;
+  }
+
+  std::vector<trace_record_t> records;
+  if (!load_trace(trace_path, records))
+  {
+    std::cerr << "cannot read " << trace_path << "\n";
+    return 2;
+  }
+  std::sort(records.begin(), records.end(),
+            [](const trace_record_t &a, const trace_record_t &b)
+            { return a.t_ms < b.t_ms; });
+
+  host_load_trace(records, tail_ms);
+  try
+  {
+    setup();
+    for (;;)
+      loop();
+  }
+  catch (const host_replay_done &)
+  {
+  }
+
+  const std::vector<std::string> &out = host_output_log();
+  if (!expect_path)
+  {
+    for (const std::string &line : out)
+      std::cout << line << "\n";
+    return 0;
+  }
+
+  std::ifstream expect(expect_path);
+  std::string line;
+  size_t i = 0;
+  while (std::getline(expect, line))
+  {
+    if (i >= out.size() || out[i] != line)
+    {
+      std::cerr << "mismatch at output line " << i + 1 << "\n  expected: " << line
+                << "\n  actual:   " << (i < out.size() ? out[i] : "<end of output>") << "\n";
+      return 1;
+    }
+    i++;
+  }
+  if (i != out.size())
+  {
+    std::cerr << "replay produced " << out.size() - i << " extra lines\n";
+    return 1;
+  }
+  std::cout << "replay matches " << expect_path << " (" << out.size() << " lines)\n";
+  return 0;
+}
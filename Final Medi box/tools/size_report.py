@@ -0,0 +1,64 @@
+# PlatformIO post script: flash and RAM use of a firmware target.
+#
+# Runs after every link of an ESP32 environment (extra_scripts in
+# platformio.ini), sums the ELF sections by the memory they occupy and
+# prints the result together with the target's MEDIBOX_WITH_* features. The
+# same text is written to .pio/build/<env>/size_report.txt, so the feature
+# builds can be compared side by side.
+
+import os
+import subprocess
+
+Import("env")
+
+# Section name prefixes of an ESP32 image, by the memory they end up in
+REGIONS = [
+    ("flash code", (".flash.text",)),
+    ("flash data", (".flash.rodata", ".flash.appdesc")),
+    ("IRAM", (".iram0",)),
+    ("DRAM data", (".dram0.data",)),
+    ("DRAM bss", (".dram0.bss", ".noinit")),
+    ("RTC data", (".rtc.text", ".rtc.data")),
+    ("RTC bss", (".rtc.bss", ".rtc_noinit")),
+]
+
+
+def sections(elf):
+    out = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf], universal_newlines=True)
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            yield parts[0], int(parts[1])
+
+
+def features():
+    found = []
+    for define in env.get("CPPDEFINES", []):
+        if isinstance(define, (list, tuple)) and str(define[0]).startswith("MEDIBOX_WITH_"):
+            found.append("%s=%s" % (str(define[0])[len("MEDIBOX_WITH_"):].lower(), define[1]))
+    return " ".join(found) if found else "all"
+
+
+def size_report(source, target, env):
+    totals = dict((name, 0) for name, _ in REGIONS)
+    for section, size in sections(target[0].get_abspath()):
+        for name, prefixes in REGIONS:
+            if section.startswith(prefixes):
+                totals[name] += size
+                break
+    # Initialised data and RAM code are stored in flash as well
+    flash = sum(totals[name] for name in ("flash code", "flash data", "IRAM", "DRAM data", "RTC data"))
+    ram = totals["DRAM data"] + totals["DRAM bss"]
+    rtc_ram = totals["RTC data"] + totals["RTC bss"]
+
+    lines = ["Size report for %s (features: %s)" % (env["PIOENV"], features())]
+    lines += ["  %-11s %8d" % (name, totals[name]) for name, _ in REGIONS]
+    lines += ["  %-11s %8d" % ("flash total", flash), "  %-11s %8d" % ("static RAM", ram),
+              "  %-11s %8d" % ("RTC RAM", rtc_ram)]
+    text = "\n".join(lines)
+    print(text)
+    with open(os.path.join(env.subst("$BUILD_DIR"), "size_report.txt"), "w") as f:
+        f.write(text + "\n")
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
@@ -0,0 +1,388 @@
+// Host decoder for the firmware's binary serial telemetry (see
+// include/telemetry_frame.h). Reads the raw UART stream from a file or
+// stdin and writes one line per record:
+//
+//   stty -F /dev/ttyUSB0 921600 raw
+//   .pio/build/telemetry_decode/program [--csv | --json | --text] [/dev/ttyUSB0]
+//
+// --csv (default) prefixes each record with its type and writes a "#"
+// header line the first time a type appears; --json writes JSON lines;
+// --text writes only console text, e.g. a 'T' trace dump for
+// tools/replay, leaving out log messages. Frames lost on the device
+// (sequence gaps), CRC failures and malformed frames are summarised on
+// stderr at the end of input or on Ctrl-C.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+#include "telemetry_frame.h"
+
+enum output_t
+{
+  OUT_CSV,
+  OUT_JSON,
+  OUT_TEXT
+};
+
+struct decode_stats_t
+{
+  unsigned long long bytes;
+  unsigned long frames;
+  unsigned long crc_errors;
+  unsigned long malformed;
+  unsigned long lost;     // sequence gaps
+  unsigned long restarts; // sequence went back to 0
+  unsigned long device_dropped;
+};
+
+static volatile sig_atomic_t interrupted = 0;
+static decode_stats_t stats = {};
+static output_t output = OUT_CSV;
+static bool have_seq = false;
+static uint16_t last_seq = 0;
+static bool header_done[16] = {};
+
+// Same order as dose_action_t and config_key_t in the firmware
+static const char *action_names[] = {"taken", "snoozed", "missed"};
+static const char *config_names[] = {"time_zone", "alarm", "snooze"};
+static const char *level_names[] = {"?", "error", "warn", "info", "debug"};
+static const char *period_names[] = {"day", "week", "lifetime"}; // exposure_period_t
+static const char *cause_names[] = {"none", "panic", "restart"}; // crash_cause_t
+static const char *reset_names[] = {"unknown", "poweron", "ext", "sw", "panic", "int_wdt",
+                                    "task_wdt", "wdt", "deepsleep", "brownout", "sdio"}; // esp_reset_reason_t
+
+static const char *name_of(const char *const *names, int n, unsigned i)
+{
+  return i < (unsigned)n ? names[i] : "?";
+}
+
+static std::string escaped(const uint8_t *p, size_t n, bool json)
+{
+  std::string s;
+  for (size_t i = 0; i < n; i++)
+  {
+    char c = (char)p[i];
+    if (c == '"')
+      s += json ? "\\\"" : "\"\"";
+    else if (json && c == '\\')
+      s += "\\\\";
+    else if ((uint8_t)c < 0x20)
+      s += ' ';
+    else
+      s += c;
+  }
+  return s;
+}
+
+static double scaled(int16_t v)
+{
+  return v / 100.0;
+}
+
+// Fixed-point field, empty (CSV) or null (JSON) if TLM_NO_VALUE
+static std::string optional(int16_t v, bool json)
+{
+  if (v == TLM_NO_VALUE)
+    return json ? "null" : "";
+  char text[16];
+  snprintf(text, sizeof(text), "%.2f", scaled(v));
+  return text;
+}
+
+static void header(uint8_t type, const char *columns)
+{
+  if (output != OUT_CSV || type >= 16 || header_done[type])
+    return;
+  header_done[type] = true;
+  printf("# %s\n", columns);
+}
+
+static void emit(const uint8_t *r, size_t body_len)
+{
+  uint8_t type = r[0];
+  unsigned seq = tlm_get_u16(r + 1);
+  unsigned long t_ms = tlm_get_u32(r + 3);
+  const uint8_t *b = r + TLM_HEADER_BYTES;
+  bool json = output == OUT_JSON;
+
+  if (type == TLM_TEXT)
+  {
+    if (output == OUT_TEXT)
+      printf("%.*s\n", (int)body_len, (const char *)b);
+    else if (json)
+      printf("{\"type\":\"text\",\"seq\":%u,\"t_ms\":%lu,\"text\":\"%s\"}\n", seq, t_ms, escaped(b, body_len, true).c_str());
+    else
+    {
+      header(type, "text,seq,t_ms,text");
+      printf("text,%u,%lu,\"%s\"\n", seq, t_ms, escaped(b, body_len, false).c_str());
+    }
+    return;
+  }
+  if (type == TLM_LOG && body_len >= 1)
+  {
+    const char *level = name_of(level_names, 5, b[0]);
+    if (json)
+      printf("{\"type\":\"log\",\"seq\":%u,\"t_ms\":%lu,\"level\":\"%s\",\"text\":\"%s\"}\n", seq, t_ms, level,
+             escaped(b + 1, body_len - 1, true).c_str());
+    else if (output == OUT_CSV)
+    {
+      header(type, "log,seq,t_ms,level,text");
+      printf("log,%u,%lu,%s,\"%s\"\n", seq, t_ms, level, escaped(b + 1, body_len - 1, false).c_str());
+    }
+    return;
+  }
+  tlm_metrics_t m;
+  if (type == TLM_METRICS && body_len >= TLM_METRICS_BYTES)
+  {
+    tlm_unpack_metrics(b, m);
+    stats.device_dropped = m.frames_dropped;
+  }
+  if (output == OUT_TEXT)
+    return;
+
+  if (type == TLM_SAMPLE && body_len >= 5)
+  {
+    int16_t t = (int16_t)tlm_get_u16(b + 1), h = (int16_t)tlm_get_u16(b + 3);
+    char temp[16] = "", hum[16] = "";
+    if (t != TLM_NO_VALUE)
+      snprintf(temp, sizeof(temp), "%.2f", scaled(t));
+    if (h != TLM_NO_VALUE)
+      snprintf(hum, sizeof(hum), "%.2f", scaled(h));
+    if (json)
+      printf("{\"type\":\"sample\",\"seq\":%u,\"t_ms\":%lu,\"sensor\":%u,\"temp\":%s,\"hum\":%s}\n", seq, t_ms, b[0],
+             *temp ? temp : "null", *hum ? hum : "null");
+    else
+    {
+      header(type, "sample,seq,t_ms,sensor,temp,hum");
+      printf("sample,%u,%lu,%u,%s,%s\n", seq, t_ms, b[0], temp, hum);
+    }
+  }
+  else if (type == TLM_ALARM && body_len >= 5)
+  {
+    long due = (int32_t)tlm_get_u32(b + 1);
+    if (json)
+      printf("{\"type\":\"alarm\",\"seq\":%u,\"t_ms\":%lu,\"alarm\":%u,\"due\":%ld}\n", seq, t_ms, b[0] + 1, due);
+    else
+    {
+      header(type, "alarm,seq,t_ms,alarm,due");
+      printf("alarm,%u,%lu,%u,%ld\n", seq, t_ms, b[0] + 1, due);
+    }
+  }
+  else if (type == TLM_DOSE && body_len >= 10)
+  {
+    const char *action = name_of(action_names, 3, b[1]);
+    long due = (int32_t)tlm_get_u32(b + 2), latency = (int32_t)tlm_get_u32(b + 6);
+    if (json)
+      printf("{\"type\":\"dose\",\"seq\":%u,\"t_ms\":%lu,\"alarm\":%u,\"action\":\"%s\",\"due\":%ld,\"latency_s\":%ld}\n",
+             seq, t_ms, b[0] + 1, action, due, latency);
+    else
+    {
+      header(type, "dose,seq,t_ms,alarm,action,due,latency_s");
+      printf("dose,%u,%lu,%u,%s,%ld,%ld\n", seq, t_ms, b[0] + 1, action, due, latency);
+    }
+  }
+  else if (type == TLM_CONFIG && body_len >= 9)
+  {
+    const char *key = name_of(config_names, 3, b[0]);
+    long v0 = (int32_t)tlm_get_u32(b + 1), v1 = (int32_t)tlm_get_u32(b + 5);
+    if (json)
+      printf("{\"type\":\"config\",\"seq\":%u,\"t_ms\":%lu,\"key\":\"%s\",\"value\":[%ld,%ld]}\n", seq, t_ms, key, v0, v1);
+    else
+    {
+      header(type, "config,seq,t_ms,key,value0,value1");
+      printf("config,%u,%lu,%s,%ld,%ld\n", seq, t_ms, key, v0, v1);
+    }
+  }
+  else if (type == TLM_CLOCK && body_len >= 4)
+  {
+    unsigned long epoch = tlm_get_u32(b);
+    if (json)
+      printf("{\"type\":\"clock\",\"seq\":%u,\"t_ms\":%lu,\"epoch\":%lu}\n", seq, t_ms, epoch);
+    else
+    {
+      header(type, "clock,seq,t_ms,epoch");
+      printf("clock,%u,%lu,%lu\n", seq, t_ms, epoch);
+    }
+  }
+  else if (type == TLM_METRICS && body_len >= TLM_METRICS_BYTES)
+  {
+    if (json)
+      printf("{\"type\":\"metrics\",\"seq\":%u,\"t_ms\":%lu,\"uptime_s\":%lu,\"free_heap\":%lu,\"largest_block\":%lu,"
+             "\"max_loop_gap_ms\":%lu,\"events_dropped\":%lu,\"bus_deferred\":%lu,\"clock_offset_us\":%ld,"
+             "\"drift_ppm\":%.2f,\"frames_dropped\":%lu}\n",
+             seq, t_ms, (unsigned long)m.uptime_s, (unsigned long)m.free_heap, (unsigned long)m.largest_block,
+             (unsigned long)m.max_loop_gap_ms, (unsigned long)m.events_dropped, (unsigned long)m.bus_deferred,
+             (long)m.clock_offset_us, scaled(m.drift_ppm_x100), (unsigned long)m.frames_dropped);
+    else
+    {
+      header(type, "metrics,seq,t_ms,uptime_s,free_heap,largest_block,max_loop_gap_ms,events_dropped,bus_deferred,"
+                   "clock_offset_us,drift_ppm,frames_dropped");
+      printf("metrics,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%ld,%.2f,%lu\n", seq, t_ms, (unsigned long)m.uptime_s,
+             (unsigned long)m.free_heap, (unsigned long)m.largest_block, (unsigned long)m.max_loop_gap_ms,
+             (unsigned long)m.events_dropped, (unsigned long)m.bus_deferred, (long)m.clock_offset_us,
+             scaled(m.drift_ppm_x100), (unsigned long)m.frames_dropped);
+    }
+  }
+  else if (type == TLM_EXPOSURE && body_len >= TLM_EXPOSURE_BYTES)
+  {
+    tlm_exposure_t x;
+    tlm_unpack_exposure(b, x);
+    const char *period = name_of(period_names, 3, x.period);
+    if (json)
+      printf("{\"type\":\"exposure\",\"seq\":%u,\"t_ms\":%lu,\"sensor\":%u,\"period\":\"%s\",\"seconds\":%lu,"
+             "\"mkt\":%s,\"temp_above_cmin\":%.1f,\"temp_below_cmin\":%.1f,\"hum_above_pctmin\":%.1f,"
+             "\"hum_below_pctmin\":%.1f,\"hum_mean\":%s}\n",
+             seq, t_ms, x.sensor, period, (unsigned long)x.seconds, optional(x.mkt_x100, true).c_str(),
+             x.temp_above_x10 / 10.0, x.temp_below_x10 / 10.0, x.hum_above_x10 / 10.0, x.hum_below_x10 / 10.0,
+             optional(x.hum_mean_x100, true).c_str());
+    else
+    {
+      header(type, "exposure,seq,t_ms,sensor,period,seconds,mkt,temp_above_cmin,temp_below_cmin,hum_above_pctmin,"
+                   "hum_below_pctmin,hum_mean");
+      printf("exposure,%u,%lu,%u,%s,%lu,%s,%.1f,%.1f,%.1f,%.1f,%s\n", seq, t_ms, x.sensor, period,
+             (unsigned long)x.seconds, optional(x.mkt_x100, false).c_str(), x.temp_above_x10 / 10.0,
+             x.temp_below_x10 / 10.0, x.hum_above_x10 / 10.0, x.hum_below_x10 / 10.0,
+             optional(x.hum_mean_x100, false).c_str());
+    }
+  }
+  else if (type == TLM_CRASH && body_len >= TLM_CRASH_BYTES)
+  {
+    tlm_crash_t c;
+    tlm_unpack_crash(b, c);
+    const char *reset = name_of(reset_names, 11, c.reset_reason), *cause = name_of(cause_names, 3, c.cause);
+    std::string backtrace;
+    for (int i = 0; i < TLM_CRASH_BACKTRACE && i < c.backtrace_depth; i++)
+    {
+      char pc[16];
+      snprintf(pc, sizeof(pc), json ? "%s\"0x%08lx\"" : "%s0x%08lx", i ? (json ? "," : " ") : "",
+               (unsigned long)c.backtrace[i]);
+      backtrace += pc;
+    }
+    if (json)
+      printf("{\"type\":\"crash\",\"seq\":%u,\"t_ms\":%lu,\"reset\":\"%s\",\"cause\":\"%s\",\"uptime_ms\":%lu,"
+             "\"exccause\":%lu,\"excvaddr\":%lu,\"backtrace_depth\":%u,\"backtrace\":[%s]}\n",
+             seq, t_ms, reset, cause, (unsigned long)c.uptime_ms, (unsigned long)c.exc_cause,
+             (unsigned long)c.exc_vaddr, c.backtrace_depth, backtrace.c_str());
+    else
+    {
+      header(type, "crash,seq,t_ms,reset,cause,uptime_ms,exccause,excvaddr,backtrace_depth,backtrace");
+      printf("crash,%u,%lu,%s,%s,%lu,%lu,0x%08lx,%u,%s\n", seq, t_ms, reset, cause, (unsigned long)c.uptime_ms,
+             (unsigned long)c.exc_cause, (unsigned long)c.exc_vaddr, c.backtrace_depth, backtrace.c_str());
+    }
+  }
+  else
+    stats.malformed++;
+}
+
+static void on_frame(const uint8_t *frame, size_t n)
+{
+  uint8_t record[TLM_MAX_FRAME];
+  size_t len = tlm_cobs_decode(frame, n, record);
+  if (len < TLM_HEADER_BYTES + TLM_CRC_BYTES)
+  {
+    stats.malformed++;
+    return;
+  }
+  size_t body_len = len - TLM_HEADER_BYTES - TLM_CRC_BYTES;
+  if (tlm_crc16(record, len - TLM_CRC_BYTES) != tlm_get_u16(record + len - TLM_CRC_BYTES))
+  {
+    stats.crc_errors++;
+    return;
+  }
+  uint16_t seq = tlm_get_u16(record + 1);
+  if (have_seq)
+  {
+    uint16_t gap = seq - (uint16_t)(last_seq + 1);
+    if (seq == 0 && gap != 0)
+      stats.restarts++;
+    else if (gap < 0x8000)
+      stats.lost += gap;
+  }
+  have_seq = true;
+  last_seq = seq;
+  stats.frames++;
+  emit(record, body_len);
+}
+
+static void summary()
+{
+  fprintf(stderr, "frames=%lu bytes=%llu lost=%lu crc_errors=%lu malformed=%lu restarts=%lu device_dropped=%lu\n",
+          stats.frames, stats.bytes, stats.lost, stats.crc_errors, stats.malformed, stats.restarts,
+          stats.device_dropped);
+}
+
+static void on_interrupt(int)
+{
+  interrupted = 1;
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--csv"))
+      output = OUT_CSV;
+    else if (!strcmp(argv[i], "--json"))
+      output = OUT_JSON;
+    else if (!strcmp(argv[i], "--text"))
+      output = OUT_TEXT;
+    else if (argv[i][0] == '-' && argv[i][1] != 0)
+    {
+      fprintf(stderr, "usage: %s [--csv | --json | --text] [stream]\n", argv[0]);
+      return 2;
+    }
+    else
+      path = argv[i];
+  }
+  int fd = path && strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+  if (fd < 0)
+  {
+    fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+    return 2;
+  }
+  struct sigaction sa = {};
+  sa.sa_handler = on_interrupt;
+  sigaction(SIGINT, &sa, nullptr); // no SA_RESTART: read() returns EINTR
+  static char out_buf[1 << 16];
+  setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+  static uint8_t in[1 << 16];
+  uint8_t frame[TLM_MAX_FRAME];
+  size_t len = 0;
+  bool overflow = false;
+  while (!interrupted)
+  {
+    ssize_t n = read(fd, in, sizeof(in));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    stats.bytes += n;
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (in[i] != 0)
+      {
+        if (len < sizeof(frame))
+          frame[len++] = in[i];
+        else
+          overflow = true;
+        continue;
+      }
+      if (overflow)
+        stats.malformed++;
+      else if (len > 0)
+        on_frame(frame, len);
+      len = 0;
+      overflow = false;
+    }
+  }
+  fflush(stdout);
+  summary();
+  return 0;
+}